@@ -12,6 +12,9 @@
 #include <limits.h>
 #include <math.h>
 #include <string.h>
+#include <atomic>
+#include <memory>
+#include <utility>
 
 #include <TFT_eSPI.h>
 #include <SPI.h>
@@ -21,7 +24,15 @@
 
 // WiFi web portal (AP mode)
 #include <WiFi.h>
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>   // ESP32Async/ESPAsyncWebServer + AsyncTCP
+
+// FreeRTOS tasks (acquisition + logging on core 0, LVGL on core 1)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <esp_cpu.h>
+#include <esp_vfs_fat.h>
+#include <unistd.h>
 
 // ============================= VERSION =============================
 static const char* FW_VERSION = "v2.6.16";
@@ -30,37 +41,33 @@ static const char* FW_VERSION = "v2.6.16";
 #define USE_TOUCH 1
 #define USE_SD    1
 #define USE_WIFI  1
+#define USE_PHASE_STATS 1   // cycle-counter timing of loop phases (debug overlay + GET /stats)
+#define USE_LIVE  1         // /live WebSocket telemetry + /view page (needs USE_WIFI)
+#define USE_REPLAY 0        // /replay: feed a .cap capture or CSV log to the decoder instead of the ECU (needs USE_SD)
+#define USE_BENCH 0         // /bench: decode / tile / log encoding / full-frame render timings (stalls the render task while it runs)
+#define USE_GOVERNOR 1      // scale CPU clock, refresh and poll rates with engine / link / WiFi activity
+#define USE_CAN   1         // TWAI (CAN) input next to or instead of ECU_SERIAL (ECU broadcast, AEM wideband)
 
-// "Pause" means: throttle LVGL + stop heavy tile updates while portal is in use.
-// It should NOT blank the backlight or stop LVGL completely.
-static volatile bool uiPaused = false;
 static volatile bool lvReady  = false;   // only true after LVGL + UI objects exist
-static volatile bool portalMode = false; // NEW: when true, LVGL/UI fully stopped and TFT shows a static portal screen
-static uint8_t wifiStaCount = 0;
 
 // ============================= WIFI AP CONFIG =============================
-// ============================= UI PAUSE WHILE WIFI CLIENT CONNECTED =============================
-// When a phone/laptop connects to the ESP_DASH AP to use the web portal, the UI rendering can
-// be throttled to free CPU for better web-server stability.
-// This reduces LVGL + TFT load during portal use.
-#define PAUSE_UI_WHEN_WIFI_CLIENT 1
-#define PAUSE_UI_BACKLIGHT_OFF   0   // KEEP SCREEN VISIBLE (avoid "blank screen" symptom)
-
-static uint32_t lastWifiClientCheckMs = 0;
-static const uint32_t WIFI_CLIENT_CHECK_MS = 250;
 
 #if USE_WIFI
 
-// Forward declarations for WebServer handlers (needed for Arduino build order)
-static void handleRoot();
-static void handleSave();
-static void handleDownload();
-static void handleDownloadLatest();
-static void handleReboot();
+// Forward declarations for web handlers (needed for Arduino build order)
+static void handleRoot(AsyncWebServerRequest* req);
+static void handleSave(AsyncWebServerRequest* req);
+static void handleDownload(AsyncWebServerRequest* req);
+static void handleDownloadLatest(AsyncWebServerRequest* req);
+static void handleReboot(AsyncWebServerRequest* req);
+static void handleStats(AsyncWebServerRequest* req);
+#if USE_GOVERNOR
+static int gov_stats_json(char* out, size_t sz);
+#endif
 // Forward declarations needed by LVGL callbacks
 static void refresh_settings_list();
 static void flashSavedMsg(const char* msg);
-static void showToast(const char* title, const char* msg);
+static void showToast(const char* title, const char* msg, uint32_t showMs = 1800);
 
 
 static const char* WIFI_AP_SSID = "ESP_DASH";
@@ -68,7 +75,7 @@ static const char* WIFI_AP_PASS = "12345678"; // >=8 chars
 static const uint8_t WIFI_AP_CH = 6;
 static const bool WIFI_AP_HIDDEN = false;
 static const uint8_t WIFI_AP_MAX_CONN = 2;
-static WebServer server(80);
+static AsyncWebServer server(80);
 #endif
 
 // ============================= SPLASH =============================
@@ -85,9 +92,39 @@ static const uint32_t SPLASH_DELAY_MS = 4000;
 #endif
 static const uint32_t ECU_BAUD = 115200;
 
+// Runtime diagnostics. With USE_UART0 the debug port IS the ECU link, where stray text would
+// break the 'n' / 'r' framing (and 'B' is the burn command), so they compile out.
+#if USE_UART0
+  #define DBG_PRINTF(...) do {} while (0)
+#else
+  #define DBG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#endif
+
+// UART driver RX ring buffer (must be set before begin()). Large enough to hold several
+// full 'n' frames so nothing is lost even if acqTask is held off for a while.
+static const size_t  ECU_RX_RING_SIZE = 4096;
+static const uint8_t ECU_RX_FIFO_FULL = 64;   // driver event after this many bytes in the HW FIFO...
+static const uint8_t ECU_RX_TIMEOUT_SYM = 2;  // ...or after this many idle symbol times (frame end)
+static const size_t  ECU_RX_CHUNK = 256;      // bulk read size per driver access
+
+// ============================= CAN (TWAI) =============================
+#if USE_CAN
+#include <driver/twai.h>
+
+// Needs a 3.3 V transceiver (SN65HVD230 or similar) on two free GPIOs (CN1 / P3 on the CYD).
+static const int CAN_TX_PIN = 22;
+static const int CAN_RX_PIN = 27;
+static const uint32_t CAN_RX_QUEUE_LEN = 64;        // TWAI driver queue, frames
+// ECU broadcast: the 'n' payload in 8-byte slices, slice k at CAN_BCAST_BASE_ID + k (11-bit).
+static const uint32_t CAN_BCAST_BASE_ID = 0x5F0;
+// AEM X-Series UEGO (29-bit 0x180): bytes 0..1 lambda, big endian, 0.0001 / bit.
+static const uint32_t CAN_WBO_ID = 0x180;
+#endif
+
 // ============================= Freenove SD pins =============================
 #if USE_SD
 static const int SD_VSPI_SS   = 5;
+static const char* SD_MOUNT   = "/sd";     // SD.begin() default mount point (for VFS/POSIX calls)
 static const int SD_VSPI_SCK  = 18;
 static const int SD_VSPI_MISO = 19;
 static const int SD_VSPI_MOSI = 23;
@@ -95,16 +132,64 @@ static SPIClass sdSpi(VSPI);
 #endif
 
 // ============================= Timing Constants =============================
-static const uint32_t POLL_MS = 100;
+// Poll scheduler: the next request goes out as soon as a reply lands, capped at setting_pollMaxHz.
+static const uint32_t REQ_TIMEOUT_MIN_MS = 40;    // reply timeout is max(this, 3 x RTT)...
+static const uint32_t REQ_TIMEOUT_MAX_MS = 250;   // ...but always well inside LINK_STALE_MS
+static const uint32_t RX_BYTE_GAP_MS = 20;        // a frame that stops mid-way is dropped after this
+static const uint32_t R_RESYNC_IDLE_MS = 5;       // 'r': line must be quiet this long after an error
+static const uint32_t RTT_WINDOW_MS = 1000;       // min/avg/max RTT are published per window
 static const uint32_t LINK_STALE_MS = 700;
 static const uint32_t UI_UPDATE_MS = 60;
 static const uint32_t STATUS_UPDATE_MS = 250;
 static const uint32_t LOG_INTERVAL_MS = 100;
 static const uint32_t LOG_FLUSH_MS = 1000;
+static const uint32_t LOGS_PER_PAGE = 20;  // /logs page size
 static const uint32_t SHIFT_FLASH_MS = 180; // blink speed
 
-// When portal is connected, run LVGL timer handler at a reduced rate (~25 Hz)
-static const uint32_t LVGL_PAUSED_MS = 40;
+// ============================= Task layout =============================
+// Core 0: acqTask owns ECU_SERIAL, pollSpeeduino() and decodePayload(); logTask owns SD writes.
+//         canTask owns the TWAI driver. Both input tasks hand their channels to ecuMerge().
+//         prefsTask writes changed settings to NVS (see settingsChanged()).
+// Core 1: the Arduino loopTask (ARDUINO_RUNNING_CORE) is the render task and the ONLY task
+//         allowed to touch LVGL (dashLoop runs there).
+// The portal is ESPAsyncWebServer: handlers and download fillers run in the async_tcp task
+// (AsyncTCP), are short, and never block on a socket. Pin/prioritise it with
+// CONFIG_ASYNC_TCP_RUNNING_CORE / CONFIG_ASYNC_TCP_PRIORITY if needed.
+// The sides share the EcuData snapshot (seqlock), a few 32-bit counters and sdMutex; web
+// handlers that need the UI post a UI_REQ_* bit and dashLoop() applies it.
+static const BaseType_t  ACQ_TASK_CORE  = 0;
+static const UBaseType_t ACQ_TASK_PRIO  = 5;     // above logTask/idle, below the WiFi stack
+static const uint32_t    ACQ_TASK_STACK = 4096;
+static const BaseType_t  LOG_TASK_CORE  = 0;
+static const UBaseType_t LOG_TASK_PRIO  = 2;
+static const uint32_t    LOG_TASK_STACK = 4096;
+static const uint32_t    LOG_TASK_PERIOD_MS = 5;
+static const BaseType_t  PREFS_TASK_CORE  = 0;
+static const UBaseType_t PREFS_TASK_PRIO  = 1;   // NVS writes only when nothing else wants core 0
+static const uint32_t    PREFS_TASK_STACK = 3072;
+static const uint32_t    PREFS_TASK_PERIOD_MS = 100;
+#if USE_CAN
+static const BaseType_t  CAN_TASK_CORE  = 0;
+static const UBaseType_t CAN_TASK_PRIO  = 4;     // just below acqTask; the TWAI queue absorbs bursts
+static const uint32_t    CAN_TASK_STACK = 3072;
+#endif
+
+static TaskHandle_t acqTaskHandle = nullptr;
+static TaskHandle_t logTaskHandle = nullptr;
+static TaskHandle_t prefsTaskHandle = nullptr;
+#if USE_CAN
+static TaskHandle_t canTaskHandle = nullptr;
+#endif
+
+// Work other tasks hand to the render task (bits are OR-ed in, dashLoop() takes them all).
+enum UiRequest : uint32_t {
+  UI_REQ_APPLY    = 1u << 1,   // settings changed: relayout, overlay, settings list, "Saved"
+  UI_REQ_REC_BTN  = 1u << 2,   // recording started/stopped
+  UI_REQ_SUMMARY  = 1u << 3,   // session closed: toast its summary
+  UI_REQ_BENCH    = 1u << 4,   // /bench?run=1 (see benchRun())
+};
+static std::atomic<uint32_t> uiRequests{0};
+static inline void uiRequest(uint32_t bits) { uiRequests.fetch_or(bits, std::memory_order_release); }
 
 // ============================= Screen =============================
 static TFT_eSPI tft;
@@ -126,7 +211,7 @@ static const uint16_t C_BLUEG   = 0x3186;
 
 // ============================= Helpers =============================
 static inline uint16_t u16le(const uint8_t* p) { return (uint16_t)p[0] | ((uint16_t)p[1] << 8); }
-static inline bool bitSetU8(uint8_t v, uint8_t b) { return (v >> b) & 1U; }
+static inline uint32_t u32le(const uint8_t* p) { return (uint32_t)u16le(p) | ((uint32_t)u16le(p + 2) << 16); }
 static inline float clampf(float v, float a, float b) { return v < a ? a : (v > b ? b : v); }
 
 static inline lv_color_t lvcol(uint16_t rgb565) {
@@ -137,47 +222,247 @@ static inline lv_color_t lvcol(uint16_t rgb565) {
 }
 static inline int clampi(int v, int a, int b){ return v < a ? a : (v > b ? b : v); }
 
+// ============================= Channels ('n' payload map) =============================
+// Every channel the dash knows about, by byte offset in the Speeduino 'n' payload.
+// value = (raw * mul + bias) / 10^dec, so CSV/bin logging can stay integer-only.
+// The table is constexpr: decodeAllChannels() expands it into straight-line loads.
+// CT_U8..CT_BIT double as the binary log's on-disk type codes; CT_AFR never reaches a file.
+enum ChType : uint8_t { CT_U8 = 0, CT_S8, CT_U16, CT_S16, CT_U32, CT_BIT, CT_AFR };
+
+enum ChId : uint8_t {
+  CH_SECL = 0, CH_WARMUP, CH_DWELL, CH_MAP, CH_IAT, CH_CLT, CH_BATCOR, CH_VBAT, CH_AFR,
+  CH_EGOCOR, CH_IATCOR, CH_WUE, CH_RPM, CH_TAE, CH_GAMMAE, CH_VE, CH_AFRTGT, CH_PW1,
+  CH_TPSDOT, CH_ADV, CH_TPS, CH_LOOPS, CH_FREERAM, CH_BOOSTTGT, CH_BOOSTDUTY, CH_LAUNCH,
+  CH_RPMDOT, CH_ETHANOL, CH_FLEXCOR, CH_FLEXIGN, CH_IDLELOAD, CH_AFR2, CH_BARO,
+  CH_COUNT
+};
+
+struct ChannelDesc {
+  uint8_t     id;      // ChId (must match the row index)
+  const char* name;    // CSV / binary log column
+  const char* unit;
+  uint8_t     offset;  // byte offset in the 'n' payload
+  uint8_t     type;    // ChType
+  uint8_t     mask;    // CT_BIT: bit mask, value is 1 if any bit set
+  int16_t     mul;
+  int16_t     bias;
+  uint8_t     dec;
+};
+
+static const int TEMP_OFFSET = 40;
+
+static constexpr ChannelDesc CHANNELS[CH_COUNT] = {
+  { CH_SECL,      "secl",      "s",     0,  CT_U8,  0,    1, 0,            0 },
+  { CH_WARMUP,    "warmup",    "",      2,  CT_BIT, 0x08, 1, 0,            0 },
+  { CH_DWELL,     "dwell",     "ms",    3,  CT_U8,  0,    1, 0,            1 },
+  { CH_MAP,       "map",       "kPa",   4,  CT_U16, 0,    1, 0,            0 },
+  { CH_IAT,       "iatC",      "C",     6,  CT_U8,  0,    1, -TEMP_OFFSET, 0 },
+  { CH_CLT,       "cltC",      "C",     7,  CT_U8,  0,    1, -TEMP_OFFSET, 0 },
+  { CH_BATCOR,    "batCor",    "%",     8,  CT_U8,  0,    1, 0,            0 },
+  { CH_VBAT,      "vbat",      "V",     9,  CT_U8,  0,    1, 0,            1 },
+  { CH_AFR,       "afr",       "",      10, CT_AFR, 0,    1, 0,            2 }, // raw normalised to x100
+  { CH_EGOCOR,    "egoCor",    "%",     11, CT_U8,  0,    1, 0,            0 },
+  { CH_IATCOR,    "iatCor",    "%",     12, CT_U8,  0,    1, 0,            0 },
+  { CH_WUE,       "wue",       "%",     13, CT_U8,  0,    1, 0,            0 },
+  { CH_RPM,       "rpm",       "rpm",   14, CT_U16, 0,    1, 0,            0 },
+  { CH_TAE,       "tae",       "%",     16, CT_U8,  0,    1, 0,            0 },
+  { CH_GAMMAE,    "gammaE",    "%",     17, CT_U8,  0,    1, 0,            0 },
+  { CH_VE,        "ve",        "%",     18, CT_U8,  0,    1, 0,            0 },
+  { CH_AFRTGT,    "afrTgt",    "",      19, CT_U8,  0,    1, 0,            1 },
+  { CH_PW1,       "pw1",       "ms",    20, CT_U16, 0,    1, 0,            3 },
+  { CH_TPSDOT,    "tpsDot",    "%/s",   22, CT_U8,  0,    10, 0,           0 },
+  { CH_ADV,       "advance",   "deg",   23, CT_S8,  0,    1, 0,            0 },
+  { CH_TPS,       "tps",       "%",     24, CT_U8,  0,    5, 0,            1 },
+  { CH_LOOPS,     "loops",     "/s",    25, CT_U16, 0,    1, 0,            0 },
+  { CH_FREERAM,   "freeRam",   "B",     27, CT_U16, 0,    1, 0,            0 },
+  { CH_BOOSTTGT,  "boostTgt",  "kPa",   29, CT_U8,  0,    2, 0,            0 },
+  { CH_BOOSTDUTY, "boostDuty", "%",     30, CT_U8,  0,    1, 0,            0 },
+  { CH_LAUNCH,    "launch",    "",      31, CT_BIT, 0x03, 1, 0,            0 }, // hard | soft
+  { CH_RPMDOT,    "rpmDot",    "rpm/s", 32, CT_S16, 0,    1, 0,            0 },
+  { CH_ETHANOL,   "ethanol",   "%",     34, CT_U8,  0,    1, 0,            0 },
+  { CH_FLEXCOR,   "flexCor",   "%",     35, CT_U8,  0,    1, 0,            0 },
+  { CH_FLEXIGN,   "flexIgn",   "deg",   36, CT_U8,  0,    1, 0,            0 },
+  { CH_IDLELOAD,  "idleLoad",  "%",     37, CT_U8,  0,    1, 0,            0 },
+  { CH_AFR2,      "afr2",      "",      39, CT_U8,  0,    1, 0,            1 },
+  { CH_BARO,      "baro",      "kPa",   40, CT_U8,  0,    1, 0,            0 },
+};
+
+static constexpr uint8_t chWidth(uint8_t type) {
+  return (type == CT_U16 || type == CT_S16 || type == CT_AFR) ? 2 : (type == CT_U32 ? 4 : 1);
+}
+static constexpr bool channelTableOk() {
+  for (int i = 0; i < CH_COUNT; i++) if (CHANNELS[i].id != i) return false;
+  return true;
+}
+static_assert(channelTableOk(), "CHANNELS rows must be in ChId order");
+
+// Smallest payload that holds every channel (fast path in decodeAllChannels).
+static constexpr int channelFrameLen() {
+  int n = 0;
+  for (int i = 0; i < CH_COUNT; i++) {
+    int end = CHANNELS[i].offset + chWidth(CHANNELS[i].type);
+    if (end > n) n = end;
+  }
+  return n;
+}
+static constexpr int CH_FRAME_LEN = channelFrameLen();
+
+static const float POW10_INV[] = { 1.0f, 0.1f, 0.01f, 0.001f, 0.0001f };
+
 // ============================= Types =============================
+// Transports that feed the channel snapshot (see ecuMerge()). A higher value wins a channel
+// both provide while it is fresh: a dedicated CAN sensor beats the ECU's echo of it.
+enum EcuSource : uint8_t { SRC_SERIAL = 0, SRC_CAN, SRC_COUNT };
+
+// Set of channels, bit per ChId.
+typedef uint64_t ChMask;
+static_assert(CH_COUNT <= 64, "ChMask holds one bit per channel");
+static constexpr ChMask chBit(uint8_t id) { return (ChMask)1 << id; }
+static constexpr ChMask CH_ALL = (CH_COUNT == 64) ? ~(ChMask)0 : chBit(CH_COUNT) - 1;
+
+// One merged frame: raw channel values exactly as the ECU sent them (sign-extended).
+// lastUpdateMs only moves on primary frames (see ecuMerge()), so it paces the rest of the dash.
 struct EcuData {
-  int rpm = 0;
-  int iatC = 0;
-  int cltC = 0;
-  float vbat = 0.0f;
-  float afr = 0.0f;
-  int tps = 0;
-  int advance = 0;
-  bool warmup = false;
-  bool launch = false;
+  int32_t raw[CH_COUNT] = {};
   uint32_t lastUpdateMs = 0;
+  uint32_t srcMs[SRC_COUNT] = {};   // last update per EcuSource, 0: never
+  ChMask srcCh[SRC_COUNT] = {};     // channels each EcuSource currently owns
+  uint16_t warn = 0;         // active warnings, bit per WarnId (warnEval())
 };
 
+static inline bool srcFresh(const EcuData& d, uint8_t src, uint32_t now) {
+  return d.srcMs[src] != 0 && (int32_t)(now - d.srcMs[src]) <= (int32_t)LINK_STALE_MS;
+}
+
+// Channels whose owning source is fresh at `now`. The others hold their last value, which
+// must not be shown or warning-checked as live.
+static inline ChMask ecuFreshMask(const EcuData& d, uint32_t now) {
+  ChMask m = 0;
+  for (uint8_t s = 0; s < SRC_COUNT; s++) if (srcFresh(d, s, now)) m |= d.srcCh[s];
+  return m;
+}
+
+// Age of the newest data from any source.
+static inline uint32_t ecuAgeMs(const EcuData& d, uint32_t now) {
+  uint32_t age = UINT32_MAX;
+  for (uint8_t s = 0; s < SRC_COUNT; s++) {
+    if (d.srcMs[s] == 0) continue;
+    const int32_t a = (int32_t)(now - d.srcMs[s]);   // a merge may land after `now` was read
+    age = min(age, a > 0 ? (uint32_t)a : 0u);
+  }
+  return age;
+}
+
+static inline int32_t chFixed(const EcuData& d, uint8_t id) {
+  return d.raw[id] * CHANNELS[id].mul + CHANNELS[id].bias;
+}
+static inline float chValue(const EcuData& d, uint8_t id) {
+  return (float)chFixed(d, id) * POW10_INV[CHANNELS[id].dec];
+}
+static inline int chInt(const EcuData& d, uint8_t id) { return (int)lroundf(chValue(d, id)); }
+
+static const int TILE_COUNT = 8;
+
+// Last drawn value per widget (fixed-point, see chFixed), so unchanged tiles are skipped.
 struct PrevData {
   int rpm = INT32_MIN;
-  int iatC = INT32_MIN;
-  int cltC = INT32_MIN;
-  int vbat10 = INT32_MIN;
-  int afrScaled = INT32_MIN;
-  int tps = INT32_MIN;
-  int advance = INT32_MIN;
-  int warmup = INT32_MIN;
-  int launch = INT32_MIN;
+  int32_t tile[TILE_COUNT] = { INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN,
+                               INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN };
+  uint16_t warn = UINT16_MAX;
+};
+
+// -------------------- Lock-free SPSC queue --------------------
+// One producer task, one consumer task, no locks. N must be a power of two.
+// head/tail are free-running counters; only the producer writes head, only the consumer tail.
+template <typename T, uint32_t N>
+struct SpscQueue {
+  static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+  T buf[N];
+  std::atomic<uint32_t> head{0};
+  std::atomic<uint32_t> tail{0};
+
+  bool push(const T& v) {
+    const uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N) return false; // full
+    buf[h & (N - 1)] = v;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+  bool pop(T& out) {
+    const uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) return false;     // empty
+    out = buf[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+  // Consumer side only.
+  void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+  uint32_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
 };
 
 // -------------------- AFR format --------------------
-enum AfrFormat { AFR_U16_x100 = 0, AFR_U16_x10 = 1, AFR_U8_div10 = 2 };
+enum AfrFormat : uint8_t { AFR_U16_x100 = 0, AFR_U16_x10 = 1, AFR_U8_div10 = 2 };
+
+// -------------------- ECU protocol --------------------
+// PROTO_N: legacy unframed 'n'. PROTO_R: msEnvelope + CRC32 'r' (newer Speeduino firmware).
+enum EcuProto : uint8_t { PROTO_N = 0, PROTO_R = 1 };
+static const uint8_t R_PIPE_MAX = 4;
+
+// -------------------- ECU input --------------------
+// IN_CAN leaves ECU_SERIAL unpolled (free for other uses); the TWAI transport needs USE_CAN.
+enum EcuInput : uint8_t { IN_SERIAL = 0, IN_SERIAL_CAN = 1, IN_CAN = 2, IN_COUNT };
 
 // -------------------- Settings (persisted) --------------------
 static Preferences prefs;
 static AfrFormat setting_afrFmt = AFR_U8_div10;
+static uint8_t setting_ecuProto = PROTO_N;
+static uint8_t setting_pipeDepth = 2;      // 'r' requests in flight (1..R_PIPE_MAX)
+static uint8_t setting_pollMaxHz = 50;     // request rate cap (1..100)
+static uint8_t setting_ecuInput = IN_SERIAL;
+static bool setting_canWbo = false;        // AEM X-Series wideband on CAN drives CH_AFR
 static uint32_t setting_logIndex = 1;
 static bool setting_logEnabled = true;
 
+// log file format
+enum LogFormat { LOG_FMT_CSV = 0, LOG_FMT_BIN = 1, LOG_FMT_BIN_DELTA = 2, LOG_FMT_COUNT };
+static uint8_t setting_logFmt = LOG_FMT_CSV;
+static bool setting_logEveryFrame = false; // false: sample every LOG_INTERVAL_MS, true: every decoded frame
+static bool setting_statsOverlay = false;  // phase timing overlay on scr_dash
+static uint16_t setting_gaugeSmoothMs = 80; // needle/bar filter time constant, 0: no smoothing
+static uint16_t setting_logPreallocMb = 0; // >0: reserve a contiguous log file of this size (MB)
+static bool setting_bbAutoRec = false;     // a warning or the shift light starts REC (black box)
+static bool setting_logRawCap = false;     // REC also writes the raw ECU bytes to a .cap file
+static bool setting_govEnabled = true;     // performance governor; off: always full clock / rates
+
 // Thresholds
 struct WarnCfg { bool enabled; float minV; float maxV; };
 
-enum WarnId { W_AFR=0, W_VBAT, W_IAT, W_CLT, W_TPS, W_ADV, W_COUNT };
+enum WarnId { W_AFR=0, W_VBAT, W_IAT, W_CLT, W_TPS, W_ADV, W_CLT_RATE, W_COUNT };
 static WarnCfg warnCfg[W_COUNT];
 
+// How each WarnId is evaluated (see warnEval()); warnCfg holds the user-set window.
+// A warning raises after the reading has been outside [minV, maxV] for onMs, and clears
+// once it has been back inside by at least hyst for offMs.
+enum WarnSignal : uint8_t { WS_VALUE = 0, WS_RATE = 1 };   // RATE: units/s over the last WARN_RATE_WINDOW_MS
+struct WarnRule {
+  uint8_t  ch;       // ChId
+  uint8_t  signal;   // WarnSignal
+  float    hyst;
+  uint16_t onMs, offMs;
+};
+static const WarnRule WARN_RULES[W_COUNT] = {
+  { CH_AFR,  WS_VALUE, 0.2f,  300,  500 },   // tip-in lean spikes are shorter than onMs
+  { CH_VBAT, WS_VALUE, 0.2f, 1000, 1000 },   // ignores the cranking dip
+  { CH_IAT,  WS_VALUE, 1.0f,  500, 1000 },
+  { CH_CLT,  WS_VALUE, 1.0f,  500, 1000 },
+  { CH_TPS,  WS_VALUE, 1.0f,    0,  200 },
+  { CH_ADV,  WS_VALUE, 1.0f,  100,  200 },
+  { CH_CLT,  WS_RATE,  0.5f,    0, 2000 },   // C/s
+};
+static const uint32_t WARN_RATE_WINDOW_MS = 2000;
+static const uint8_t  WARN_RATE_SLOTS = 8;   // rate baseline samples, WARN_RATE_WINDOW_MS / 8 apart
+static std::atomic<uint16_t> warnMask{0};   // latest warnEval() result
+
 // shift light
 static int setting_shiftRpm = 6500;
 static bool setting_shiftEnabled = true;
@@ -189,21 +474,140 @@ static uint8_t setting_viewMode = VIEW_RING;
 // -------------------- SD logging --------------------
 #if USE_SD
 static bool sdOk = false;
-static bool recording = false;
+static volatile bool recording = false;
 static File logFile;
 static uint32_t lastLogMs = 0;
-static volatile bool portalBusy = false; // prevents SD read while handler running
+// Every SD call (log writes on logTask, REC start/stop, portal listing/downloads on async_tcp)
+// runs under sdMutex. It is recursive so helpers can lock on their own, and portal code only
+// holds it per chunk, so a download never stalls logTask for more than one block read.
+static SemaphoreHandle_t sdMutex = nullptr;
+static char logFileName[32] = "";   // file being recorded (portal won't serve it)
+
+// "Log every frame": ecuMerge() pushes each frame, logTask drains it.
+// Popping only happens with sdMutex held, so stopRecording() can flush the tail safely.
+static const uint32_t LOG_QUEUE_LEN = 64;   // ~1.3 s of frames at 50 Hz, ~10.7 KB of internal RAM
+static_assert(sizeof(EcuData) <= 168, "EcuData grew: recheck the LOG_QUEUE_LEN RAM note");
+static SpscQueue<EcuData, LOG_QUEUE_LEN> logQueue;
+static volatile bool recEveryFrame = false;  // latched from setting_logEveryFrame at REC start
+static uint8_t recFmt = LOG_FMT_CSV;          // latched from setting_logFmt at REC start
+static volatile uint32_t logQueueDrops = 0;
 #endif
 
 // -------------------- State --------------------
-static EcuData ecu;
+static EcuData ecuRx;      // merged working copy (ecuMerge() only)
+static SemaphoreHandle_t ecuMergeMutex = nullptr;
+static uint32_t ecuMergeMs = 0;     // newest merge timestamp (ecuMerge() only)
 static PrevData prev;
 
+// -------------------- ECU snapshot (seqlock) --------------------
+// ecuMerge() is the single writer (input tasks take turns on ecuMergeMutex). Readers (render/log/web) copy the whole struct out and
+// retry if a publish raced them, so they never see a half-written frame and never block it.
+static volatile uint32_t ecuSeq = 0;
+static EcuData ecuShared;
+
+static void ecuPublish(const EcuData& d) {
+  ecuSeq = ecuSeq + 1;   // odd: write in progress
+  __sync_synchronize();
+  ecuShared = d;
+  __sync_synchronize();
+  ecuSeq = ecuSeq + 1;   // even: stable
+}
+
+static void ecuSnapshot(EcuData& out) {
+  uint32_t s0, s1;
+  do {
+    do { s0 = ecuSeq; } while (s0 & 1U);
+    __sync_synchronize();
+    out = ecuShared;
+    __sync_synchronize();
+    s1 = ecuSeq;
+  } while (s0 != s1);
+}
+
 // -------------------- Shift overlay --------------------
 static bool shiftActive = false;
 static uint32_t shiftBlinkT0 = 0;
 static bool shiftBlinkOn = false;
 
+// ============================= Phase stats =============================
+// Cycle-counter timing of the loop phases. Each phase is only recorded from one task (pinned),
+// so the accumulators need no lock and cycle counts never mix cores. Once per PHASE_WINDOW_MS
+// the writer folds its window into phaseOut[] (us), which the overlay and /stats read.
+// p99 comes from a log2 histogram with 2 sub-bits per octave (bucket width <= 25%).
+// Nesting: drain includes decode, lvgl includes a blocking flush.
+// http is each handler call and each download filler call (one chunk); live is one /live push pass.
+// can is one canTask merge (slice decode + ecuMerge()).
+enum Phase : uint8_t { PH_DRAIN = 0, PH_DECODE, PH_UI, PH_LVGL, PH_FLUSH, PH_LOG, PH_HTTP, PH_LIVE, PH_CAN, PH_COUNT };
+static const char* const PHASE_NAMES[PH_COUNT] = { "drain", "decode", "ui", "lvgl", "flush", "log", "http", "live", "can" };
+
+#if USE_PHASE_STATS
+static const uint32_t PHASE_WINDOW_MS = 1000;
+static const int PHASE_HIST_BUCKETS = 128;
+
+struct PhaseAcc {
+  uint32_t n, minCyc, maxCyc, t0Ms;
+  uint64_t sumCyc;
+  uint16_t hist[PHASE_HIST_BUCKETS];
+};
+struct PhaseSummary { uint32_t n, minUs, avgUs, p99Us, maxUs; };
+
+static PhaseAcc phaseAcc[PH_COUNT];
+static PhaseSummary phaseOut[PH_COUNT];   // debug only: a torn read just shows a mixed window
+static uint32_t phaseCpuMhz = 240;
+
+static inline uint8_t phaseBucket(uint32_t c) {
+  if (c < 4) return (uint8_t)c;
+  const int msb = 31 - __builtin_clz(c);
+  return (uint8_t)(((msb - 1) << 2) | ((c >> (msb - 2)) & 3));
+}
+static inline uint32_t phaseBucketTop(int b) {
+  if (b < 4) return (uint32_t)b;
+  const int msb = (b >> 2) + 1;
+  return (((uint32_t)(4 | (b & 3))) << (msb - 2)) + ((1u << (msb - 2)) - 1);
+}
+
+static void phaseRoll(uint8_t ph, uint32_t now) {
+  PhaseAcc& a = phaseAcc[ph];
+  PhaseSummary s = {};
+  s.n = a.n;
+  if (a.n) {
+    const uint32_t want = (uint32_t)(((uint64_t)a.n * 99 + 99) / 100);
+    uint32_t cum = 0;
+    int b = 0;
+    for (; b < PHASE_HIST_BUCKETS - 1; b++) { cum += a.hist[b]; if (cum >= want) break; }
+    s.minUs = a.minCyc / phaseCpuMhz;
+    s.avgUs = (uint32_t)(a.sumCyc / a.n / phaseCpuMhz);
+    s.p99Us = min(phaseBucketTop(b), a.maxCyc) / phaseCpuMhz;
+    s.maxUs = a.maxCyc / phaseCpuMhz;
+  }
+  phaseOut[ph] = s;
+  memset(&a, 0, sizeof(a));
+  a.t0Ms = now;
+}
+
+static void phaseRecord(uint8_t ph, uint32_t cyc) {
+  PhaseAcc& a = phaseAcc[ph];
+  if (a.n == 0 || cyc < a.minCyc) a.minCyc = cyc;
+  if (cyc > a.maxCyc) a.maxCyc = cyc;
+  a.sumCyc += cyc;
+  a.n++;
+  uint16_t& h = a.hist[phaseBucket(cyc)];
+  if (h != UINT16_MAX) h++;
+  const uint32_t now = millis();
+  if (now - a.t0Ms >= PHASE_WINDOW_MS) phaseRoll(ph, now);
+}
+
+struct PhaseScope {
+  uint8_t ph;
+  uint32_t t0;
+  explicit PhaseScope(uint8_t p) : ph(p), t0(esp_cpu_get_cycle_count()) {}
+  ~PhaseScope() { phaseRecord(ph, esp_cpu_get_cycle_count() - t0); }
+};
+#define PHASE_SCOPE(ph) PhaseScope phaseScope_(ph)
+#else
+#define PHASE_SCOPE(ph) do {} while (0)
+#endif
+
 // ============================= Speeduino 'n' frame reader =============================
 static const uint8_t CMD_N = 'n';
 static const int MAX_PAYLOAD = 200;
@@ -214,23 +618,88 @@ static int rxCount = 0;
 enum RxState { WAIT_N, WAIT_TYPE, WAIT_LEN, READ_PAYLOAD };
 static RxState rxState = WAIT_N;
 
+// ============================= Speeduino 'r' reader (msEnvelope + CRC32) =============================
+// Every command and reply is framed as [u16 BE len][payload][u32 BE CRC32(payload)].
+// Request payload: 'r', canId, 0x30 (output channels), u16 LE offset, u16 LE length.
+// Reply payload: status byte (0 = OK) followed by the same bytes as the 'n' payload.
+// Requests are pipelined: up to setting_pipeDepth are outstanding and replies come back in order.
+static const uint8_t  CMD_R = 'r';
+static const uint8_t  R_CAN_ID = 0;
+static const uint8_t  R_OCH_CMD = 0x30;
+static const uint8_t  R_RC_OK = 0x00;
+static const uint16_t R_REQ_LEN = CH_FRAME_LEN;  // only ask for what CHANNELS decodes
+
+enum RFrameState { RF_LEN_HI, RF_LEN_LO, RF_PAYLOAD, RF_CRC, RF_DISCARD };
+static RFrameState rfState = RF_LEN_HI;
+static uint16_t rfLen = 0;
+static int rfCount = 0;
+static uint8_t rfCrc[4];
+
+static uint8_t  ecuProto = PROTO_N;            // latched from setting_ecuProto when the UART opens
+static uint32_t ecuLastByteMs = 0;
+
+// Link quality counters (acqTask writes, UI/portal read).
+static volatile uint32_t ecuFramesOk = 0;
+static volatile uint32_t ecuCrcErrors = 0;
+static volatile uint32_t ecuBadFrames = 0;    // bad length / non-OK status
+static volatile uint32_t ecuRetries = 0;      // requests abandoned (timeout or resync)
+
+// CRC-32 (IEEE 802.3, reflected), same as the firmware's FastCRC crc32().
+struct Crc32Table {
+  uint32_t t[256];
+  constexpr Crc32Table() : t() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+      t[i] = c;
+    }
+  }
+};
+static constexpr Crc32Table CRC32_TABLE{};
+
+static uint32_t crc32(const uint8_t* p, size_t n) {
+  uint32_t c = 0xFFFFFFFFu;
+  while (n--) c = CRC32_TABLE.t[(c ^ *p++) & 0xFF] ^ (c >> 8);
+  return c ^ 0xFFFFFFFFu;
+}
+
+// -------------------- Poll scheduler --------------------
+// Requests in flight (always <= 1 for 'n'), oldest send time at reqSentTail. acqTask only.
+static uint8_t  reqInflight = 0;
+static uint8_t  reqSentHead = 0;
+static uint8_t  reqSentTail = 0;
+static uint32_t reqSentMs[R_PIPE_MAX];
+static uint32_t rttX16 = 20 * 16;              // EWMA of request -> reply time, ms x16 (pacing)
+
+struct RttWindow { uint32_t minMs, maxMs, sumMs, n, t0; };
+static RttWindow rttWin = { UINT32_MAX, 0, 0, 0, 0 };
+
+// Last completed window, for the status bar and portal. rttStatN == 0: no replies in it.
+static volatile uint32_t rttStatMinMs = 0;
+static volatile uint32_t rttStatAvgMs = 0;
+static volatile uint32_t rttStatMaxMs = 0;
+static volatile uint32_t rttStatN = 0;         // replies in the window (= Hz for a 1 s window)
+
 // -------------------- Polling & Link --------------------
+// Written by acqTask, read by the render task (aligned 32-bit, so single loads are atomic).
 static uint32_t lastPoll = 0;
-static uint32_t rxBytes = 0;
-static uint32_t lastRxMs = 0;
-static bool linkValid = false;
+static volatile uint32_t rxBytes = 0;
+static volatile bool linkValid = false;
+static bool ecuSerialOpen = false;
+#if USE_REPLAY
+static volatile bool replayActive = false;   // a log, not ECU_SERIAL, feeds the decoder
+#endif
 
-// ============================= Data mapping =============================
-static const int TEMP_OFFSET = 40;
-static const int IDX_IAT     = 6;
-static const int IDX_CLT     = 7;
-static const int IDX_VBAT10  = 9;
-static const int IDX_RPM_L   = 14;
-static const int IDX_ADVANCE = 23;
-static const int IDX_TPS     = 24;
-static const int IDX_ENGINE  = 2;
-static const int IDX_SPARKBF = 31;
-static const int AFR_INDEX   = 10;
+#if USE_GOVERNOR
+static std::atomic<uint8_t> govPollHz{100};   // governor's cap on setting_pollMaxHz (gov_apply())
+#endif
+static inline uint8_t pollCapHz() {
+#if USE_GOVERNOR
+  return min(setting_pollMaxHz, govPollHz.load(std::memory_order_relaxed));
+#else
+  return setting_pollMaxHz;
+#endif
+}
 
 // ============================= Tach config =============================
 static const int RPM_MAX = 8000;
@@ -240,6 +709,7 @@ static const int RPM_REDLINE = 7000;
 // ============================= Touch calibration =============================
 #if USE_TOUCH
 static uint16_t touchCalData[5] = { 303, 3458, 350, 3304, 7 };
+static const int TOUCH_IRQ_PIN = 36;   // XPT2046 T_IRQ (PENIRQ, low while pressed); -1: not wired
 #endif
 
 // ============================= LVGL plumbing =============================
@@ -247,30 +717,121 @@ static lv_disp_draw_buf_t draw_buf;
 static lv_color_t* buf1 = nullptr;
 static lv_color_t* buf2 = nullptr;
 
+// DMA flush: the transfer runs while LVGL renders the next area into the other buffer.
+// pushImageDMA() waits for the previous transfer before starting, so by the time LVGL reuses
+// a buffer its DMA has finished. The SPI transaction stays open across flushes; dmaFinish()
+// closes it before anything else (touch) uses the TFT bus.
+static bool tftDmaOk = false;
+static bool tftInWrite = false;
+
+static void dmaFinish() {
+  if (!tftInWrite) return;
+  tft.dmaWait();
+  tft.endWrite();
+  tftInWrite = false;
+}
+
 static void my_flush_cb(lv_disp_drv_t* disp, const lv_area_t* area, lv_color_t* color_p) {
+  PHASE_SCOPE(PH_FLUSH);
   uint32_t w = (area->x2 - area->x1 + 1);
   uint32_t h = (area->y2 - area->y1 + 1);
 
+  if (tftDmaOk) {
+    if (!tftInWrite) { tft.startWrite(); tftInWrite = true; }
+    tft.pushImageDMA(area->x1, area->y1, w, h, (uint16_t*)&color_p->full);
+    lv_disp_flush_ready(disp);
+    return;
+  }
+
   tft.startWrite();
   tft.setAddrWindow(area->x1, area->y1, w, h);
-  tft.pushColors((uint16_t*)&color_p->full, w * h, true);
+  tft.pushColors((uint16_t*)&color_p->full, w * h, !LV_COLOR_16_SWAP);
   tft.endWrite();
   lv_disp_flush_ready(disp);
 }
 
 #if USE_TOUCH
+// A touch read shares the TFT SPI bus and has to close the open DMA transaction (dmaFinish()),
+// so while the panel is idle it is skipped: T_IRQ is sampled instead (plus a latched falling
+// edge, so a tap between reads isn't lost). While pressed the read period drops to
+// TOUCH_ACTIVE_MS, points are median-of-3 filtered, and a press / release only counts after
+// TOUCH_DEBOUNCE reads in a row. An SPI read every TOUCH_CHECK_MS even with T_IRQ high checks
+// the wiring: if it finds a press, the pin isn't connected and every period reads over SPI.
+static const uint32_t TOUCH_ACTIVE_MS = 10;
+static const uint32_t TOUCH_IDLE_MS = 30;      // LV_INDEV_DEF_READ_PERIOD
+static const uint32_t TOUCH_CHECK_MS = 2000;
+static const uint8_t TOUCH_DEBOUNCE = 2;
+
+static lv_indev_t* touchIndev = nullptr;
+static volatile bool touchIrqEdge = false;
+static bool touchIrqOk = false;                // T_IRQ gating in use
+static volatile uint32_t touchSpiReads = 0;    // for /stats
+
+static void IRAM_ATTR touchIrqIsr() { touchIrqEdge = true; }
+
+static void touchSetup() {
+  if (TOUCH_IRQ_PIN < 0) return;
+  pinMode(TOUCH_IRQ_PIN, INPUT);   // GPIO34..39 have no pull-up; the panel provides one
+  attachInterrupt(digitalPinToInterrupt(TOUCH_IRQ_PIN), touchIrqIsr, FALLING);
+  touchIrqOk = true;
+}
+
+static inline uint16_t median3(uint16_t a, uint16_t b, uint16_t c) {
+  return max(min(a, b), min(max(a, b), c));
+}
+
 static void my_touch_read(lv_indev_drv_t* indev_driver, lv_indev_data_t* data) {
   static uint16_t last_x = 0, last_y = 0;
-  uint16_t x, y;
-  bool pressed = tft.getTouch(&x, &y);
+  static uint16_t hx[3], hy[3];
+  static uint8_t hi = 0, hn = 0;    // filter history (next slot, count), reset on release
+  static bool down = false;         // debounced state reported to LVGL
+  static uint8_t streak = 0;        // reads disagreeing with down
+  static uint32_t lastCheck = 0, period = TOUCH_IDLE_MS;
+
+  bool line = true;
+  bool sample = true;
+  if (touchIrqOk && !down && streak == 0) {
+    const uint32_t now = millis();
+    line = digitalRead(TOUCH_IRQ_PIN) == LOW || touchIrqEdge;
+    sample = line || now - lastCheck >= TOUCH_CHECK_MS;
+    if (!line && sample) lastCheck = now;
+  }
+
+  uint16_t x = 0, y = 0;
+  bool pressed = false;
+  if (sample) {
+    dmaFinish();
+    pressed = tft.getTouch(&x, &y);
+    touchSpiReads = touchSpiReads + 1;
+    touchIrqEdge = false;   // after the read: the XPT2046 pulls PENIRQ low during its own conversions
+    if (pressed && !line) {
+      touchIrqOk = false;
+      detachInterrupt(digitalPinToInterrupt(TOUCH_IRQ_PIN));
+      DBG_PRINTF("[TOUCH] T_IRQ not wired, polling over SPI\n");
+    }
+  }
 
   if (pressed) {
-    last_x = x;
-    last_y = y;
-    data->state = LV_INDEV_STATE_PRESSED;
+    hx[hi] = x;
+    hy[hi] = y;
+    hi = (hi + 1) % 3;
+    if (hn < 3) hn++;
+    if (hn == 3) { last_x = median3(hx[0], hx[1], hx[2]); last_y = median3(hy[0], hy[1], hy[2]); }
+    else         { last_x = x; last_y = y; }
+  }
+  if (pressed != down) {
+    if (++streak >= TOUCH_DEBOUNCE) { down = pressed; streak = 0; if (!down) hi = hn = 0; }
   } else {
-    data->state = LV_INDEV_STATE_RELEASED;
+    streak = 0;
+  }
+
+  const uint32_t want = (down || streak) ? TOUCH_ACTIVE_MS : TOUCH_IDLE_MS;
+  if (want != period && touchIndev) {
+    lv_timer_set_period(lv_indev_get_read_timer(touchIndev), want);
+    period = want;
   }
+
+  data->state = down ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
   data->point.x = last_x;
   data->point.y = last_y;
 }
@@ -282,34 +843,15 @@ static lv_obj_t* scr_dash = nullptr;
 static lv_obj_t* scr_settings = nullptr;
 static lv_obj_t* scr_shift = nullptr;
 
-// ============================= UI PAUSE (portal mode) =============================
-static lv_obj_t* lbl_webmode = nullptr;
-
-// NOTE: This must not call lv_scr_load() or otherwise "switch screens" while paused.
-// That can hang if you stop calling lv_timer_handler() afterwards.
-// Also must not touch LVGL objects before lvReady is true.
-static void setUiPaused(bool pause) {
-  if (uiPaused == pause) return;
-  uiPaused = pause;
-
-#ifdef TFT_BL
-#if PAUSE_UI_BACKLIGHT_OFF
-  if (pause) {
-    digitalWrite(TFT_BL, !TFT_BACKLIGHT_ON);
-  } else {
-    digitalWrite(TFT_BL, TFT_BACKLIGHT_ON);
-  }
-#endif
-#endif
-}
-
-
 // Status labels
 static lv_obj_t* lbl_link = nullptr;
 static lv_obj_t* lbl_rx = nullptr;
 static lv_obj_t* lbl_age = nullptr;
 static lv_obj_t* lbl_sd = nullptr;
 static lv_obj_t* lbl_rec = nullptr;
+static lv_obj_t* lbl_logq = nullptr;
+static lv_obj_t* lbl_rtt = nullptr;
+static lv_obj_t* lbl_stats = nullptr;   // phase timing overlay (setting_statsOverlay)
 static lv_obj_t* lbl_ver = nullptr;
 
 // Dash buttons
@@ -326,6 +868,9 @@ static void setRecButtonActive(bool on) {
   if (lab) lv_obj_set_style_text_color(lab, lv_color_white(), 0);
 }
 
+// Holds the active view (gauge + tiles); rebuilt on a view switch, see apply_view_layout().
+static lv_obj_t* cont_view = nullptr;
+
 // Ring view objects (traditional gauge)
 static lv_obj_t* meter_rpm = nullptr;
 static lv_meter_scale_t* meter_scale_rpm = nullptr;
@@ -333,13 +878,17 @@ static lv_meter_indicator_t* meter_arc_green = nullptr;
 static lv_meter_indicator_t* meter_arc_yellow = nullptr;
 static lv_meter_indicator_t* meter_arc_red = nullptr;
 static lv_meter_indicator_t* meter_needle = nullptr;
+static lv_meter_indicator_t* meter_arc_shift = nullptr;
+static lv_obj_t* ring_face = nullptr;     // cached meter face (replaces meter_rpm, see build_ring_gauge())
+static lv_obj_t* ring_needle = nullptr;   // needle drawn over ring_face
+static int ring_face_shift = INT_MIN;     // shift marker the face shows (-1: none)
 static lv_obj_t* lbl_rpm = nullptr;
 
 // Bar view objects
-
 static lv_obj_t* cont_bar = nullptr;
 static lv_obj_t* bar_rpm = nullptr;
 static lv_obj_t* lbl_rpm_bar = nullptr;
+static uint8_t bar_zone = 0xFF;           // colour zone bar_rpm shows (0xFF: not styled yet)
 
 // Tiles
 struct TileUI {
@@ -351,10 +900,34 @@ struct TileUI {
   uint16_t normalBar565;
   const char* name;
   const char* unit;
+  lv_style_t st_ind;   // bar indicator in normalBar565 (per tile, so it can't be shared)
+  uint8_t state;       // TileState currently applied
 };
 
 static TileUI ui_afr, ui_vbat, ui_iat, ui_clt, ui_tps, ui_adv, ui_warm, ui_launch;
-static TileUI* tiles_all[8] = { &ui_afr,&ui_vbat,&ui_iat,&ui_clt,&ui_tps,&ui_adv,&ui_warm,&ui_launch };
+static TileUI* tiles_all[TILE_COUNT] = { &ui_afr,&ui_vbat,&ui_iat,&ui_clt,&ui_tps,&ui_adv,&ui_warm,&ui_launch };
+
+// What each tile shows, in tiles_all order. It turns red for any warning on its channel.
+struct TileDef {
+  const char* name;
+  const char* unit;
+  uint16_t    bar565;
+  uint8_t     ch;      // ChId
+  float       barMin, barMax;
+  uint8_t     dec;     // displayed decimals
+  bool        onOff;   // bit channel: ACTIVE / ----
+};
+
+static const TileDef TILE_DEFS[TILE_COUNT] = {
+  { "AFR",    "",    C_YELL,  CH_AFR,    9.0f,  20.0f,  2, false },
+  { "VBAT",   "V",   C_GREEN, CH_VBAT,   10.0f, 15.5f,  1, false },
+  { "IAT",    "C",   C_AMBER, CH_IAT,    -20.0f, 80.0f, 0, false },
+  { "CLT",    "C",   C_AMBER, CH_CLT,    0.0f,  120.0f, 0, false },
+  { "TPS",    "%",   C_GREEN, CH_TPS,    0.0f,  100.0f, 0, false },
+  { "ADV",    "deg", C_YELL,  CH_ADV,    -10.0f, 50.0f, 0, false },
+  { "WARMUP", "",    C_AMBER, CH_WARMUP, 0.0f,  1.0f,   0, true  },
+  { "LAUNCH", "",    C_RED,   CH_LAUNCH, 0.0f,  1.0f,   0, true  },
+};
 
 // Shift overlay label
 static lv_obj_t* lbl_shift = nullptr;
@@ -389,438 +962,2346 @@ static void defaultsWarn() {
   warnCfg[W_CLT]  = { true,  0.0f, 105.0f };
   warnCfg[W_TPS]  = { false, 0.0f, 100.0f };
   warnCfg[W_ADV]  = { false, -10.0f, 50.0f };
+  warnCfg[W_CLT_RATE] = { false, -100.0f, 2.0f };   // rising faster than 2 C/s
 }
 
-static void loadSettings() {
-  defaultsWarn();
-  prefs.begin("espdash", true);
-
-  setting_logEnabled   = prefs.getBool("logEn", true);
-  setting_afrFmt       = (AfrFormat)prefs.getUChar("afrFmt", (uint8_t)AFR_U8_div10);
-  setting_logIndex     = prefs.getUInt("logIdx", 1);
-
-  setting_shiftEnabled = prefs.getBool("shEn", true);
-  setting_shiftRpm     = (int)prefs.getInt("shRpm", 6500);
-
-  setting_viewMode     = prefs.getUChar("view", (uint8_t)VIEW_RING);
+// Each persisted setting is one PrefKey row. prefShadow holds the bits last read from or
+// written to NVS, so prefsFlush() only puts the keys that actually changed. settingsChanged()
+// (any task) schedules a flush PREFS_COALESCE_MS after the first change; prefsTask does
+// the writes, so no handler or REC press blocks on NVS, and a burst of edits costs one write
+// per changed key. An erase still stalls the flash cache on both cores while it runs,
+// whichever task issues it; fewer writes are the only cure for that.
+// setting_logIndex isn't saved per REC at all: logIndexCheck() derives it from /logs.idx at
+// boot, and it goes out with the next flush.
+enum PrefType : uint8_t { PT_BOOL, PT_U8, PT_U16, PT_I32, PT_U32, PT_F32 };
+struct PrefKey {
+  const char* key;
+  uint8_t     type;   // PrefType
+  void*       ptr;
+};
+// Plain settings; the warning windows are appended by prefsRegister().
+static const PrefKey PREF_SETTINGS[] = {
+  { "logEn",    PT_BOOL, &setting_logEnabled },
+  { "afrFmt",   PT_U8,   &setting_afrFmt },
+  { "proto",    PT_U8,   &setting_ecuProto },
+  { "pipe",     PT_U8,   &setting_pipeDepth },
+  { "pollHz",   PT_U8,   &setting_pollMaxHz },
+  { "ecuIn",    PT_U8,   &setting_ecuInput },
+  { "canWbo",   PT_BOOL, &setting_canWbo },
+  { "logIdx",   PT_U32,  &setting_logIndex },
+  { "logFmt",   PT_U8,   &setting_logFmt },
+  { "logAll",   PT_BOOL, &setting_logEveryFrame },
+  { "prealloc", PT_U16,  &setting_logPreallocMb },
+  { "bbAuto",   PT_BOOL, &setting_bbAutoRec },
+  { "rawCap",   PT_BOOL, &setting_logRawCap },
+  { "gov",      PT_BOOL, &setting_govEnabled },
+  { "dbgOv",    PT_BOOL, &setting_statsOverlay },
+  { "gSmooth",  PT_U16,  &setting_gaugeSmoothMs },
+  { "shEn",     PT_BOOL, &setting_shiftEnabled },
+  { "shRpm",    PT_I32,  &setting_shiftRpm },
+  { "view",     PT_U8,   &setting_viewMode },
+};
+static const char*    PREFS_NS = "espdash";
+static const uint32_t PREFS_COALESCE_MS = 1500;
+static const size_t   PREF_MAX_KEYS = sizeof(PREF_SETTINGS) / sizeof(PREF_SETTINGS[0]) + 3 * W_COUNT;
+static PrefKey  prefKeys[PREF_MAX_KEYS];
+static uint32_t prefShadow[PREF_MAX_KEYS];
+static size_t   prefCount = 0;
+static char     prefWarnKeys[W_COUNT][3][6];   // "w0e", "w0n", "w0x", ...
+static SemaphoreHandle_t prefsMutex = nullptr;
+static std::atomic<uint32_t> prefsDueMs{0};     // 0: nothing scheduled
+
+// PREF_MAX_KEYS is exactly PREF_SETTINGS plus the warning keys, so this can only trip if
+// prefsRegister() grows a key outside the table.
+static void prefAdd(const char* key, uint8_t type, void* ptr) {
+  configASSERT(prefCount < PREF_MAX_KEYS);
+  prefKeys[prefCount++] = PrefKey{ key, type, ptr };
+}
 
+static void prefsRegister() {
+  if (prefCount) return;
+  for (const PrefKey& k : PREF_SETTINGS) prefAdd(k.key, k.type, k.ptr);
   for (int i = 0; i < W_COUNT; i++) {
-    char kE[8], kN[8], kX[8];
-    snprintf(kE, sizeof(kE), "w%de", i);
-    snprintf(kN, sizeof(kN), "w%dn", i);
-    snprintf(kX, sizeof(kX), "w%dx", i);
-    warnCfg[i].enabled = prefs.getBool(kE, warnCfg[i].enabled);
-    warnCfg[i].minV    = prefs.getFloat(kN, warnCfg[i].minV);
-    warnCfg[i].maxV    = prefs.getFloat(kX, warnCfg[i].maxV);
+    snprintf(prefWarnKeys[i][0], sizeof(prefWarnKeys[i][0]), "w%de", i);
+    snprintf(prefWarnKeys[i][1], sizeof(prefWarnKeys[i][1]), "w%dn", i);
+    snprintf(prefWarnKeys[i][2], sizeof(prefWarnKeys[i][2]), "w%dx", i);
+    prefAdd(prefWarnKeys[i][0], PT_BOOL, &warnCfg[i].enabled);
+    prefAdd(prefWarnKeys[i][1], PT_F32,  &warnCfg[i].minV);
+    prefAdd(prefWarnKeys[i][2], PT_F32,  &warnCfg[i].maxV);
   }
-  prefs.end();
 }
 
-static void saveSettings() {
-  prefs.begin("espdash", false);
+static uint32_t prefBits(const PrefKey& k) {
+  static const uint8_t SIZE[] = { 1, 1, 2, 4, 4, 4 };
+  uint32_t v = 0;
+  memcpy(&v, k.ptr, SIZE[k.type]);
+  return v;
+}
 
-  prefs.putBool("logEn", setting_logEnabled);
-  prefs.putUChar("afrFmt", (uint8_t)setting_afrFmt);
-  prefs.putUInt("logIdx", setting_logIndex);
+// Each variable's initial value is its default.
+static void loadSettings() {
+  defaultsWarn();
+  prefsRegister();
+  prefs.begin(PREFS_NS, true);
+  for (size_t i = 0; i < prefCount; i++) {
+    const PrefKey& k = prefKeys[i];
+    switch (k.type) {
+      case PT_BOOL: *(bool*)k.ptr     = prefs.getBool(k.key, *(bool*)k.ptr); break;
+      case PT_U8:   *(uint8_t*)k.ptr  = prefs.getUChar(k.key, *(uint8_t*)k.ptr); break;
+      case PT_U16:  *(uint16_t*)k.ptr = prefs.getUShort(k.key, *(uint16_t*)k.ptr); break;
+      case PT_I32:  *(int32_t*)k.ptr  = prefs.getInt(k.key, *(int32_t*)k.ptr); break;
+      case PT_U32:  *(uint32_t*)k.ptr = prefs.getUInt(k.key, *(uint32_t*)k.ptr); break;
+      case PT_F32:  *(float*)k.ptr    = prefs.getFloat(k.key, *(float*)k.ptr); break;
+    }
+  }
+  prefs.end();
+  if (setting_logFmt >= LOG_FMT_COUNT) setting_logFmt = LOG_FMT_CSV;
+  for (size_t i = 0; i < prefCount; i++) prefShadow[i] = prefBits(prefKeys[i]);
+}
 
-  prefs.putBool("shEn", setting_shiftEnabled);
-  prefs.putInt("shRpm", (int32_t)setting_shiftRpm);
+// Writes the keys that differ from prefShadow. prefsTask, or a caller about to reboot.
+static void prefsFlush() {
+  if (prefsMutex) xSemaphoreTake(prefsMutex, portMAX_DELAY);
+  bool open = false;
+  for (size_t i = 0; i < prefCount; i++) {
+    const PrefKey& k = prefKeys[i];
+    const uint32_t v = prefBits(k);   // one read, so a concurrent edit is caught next time
+    if (v == prefShadow[i]) continue;
+    if (!open) open = prefs.begin(PREFS_NS, false);
+    if (!open) break;
+    switch (k.type) {
+      case PT_BOOL: prefs.putBool(k.key, v != 0); break;
+      case PT_U8:   prefs.putUChar(k.key, (uint8_t)v); break;
+      case PT_U16:  prefs.putUShort(k.key, (uint16_t)v); break;
+      case PT_I32:  prefs.putInt(k.key, (int32_t)v); break;
+      case PT_U32:  prefs.putUInt(k.key, v); break;
+      case PT_F32:  { float fv; memcpy(&fv, &v, sizeof(fv)); prefs.putFloat(k.key, fv); } break;
+    }
+    prefShadow[i] = v;
+  }
+  if (open) prefs.end();
+  if (prefsMutex) xSemaphoreGive(prefsMutex);
+}
 
-  prefs.putUChar("view", setting_viewMode);
+// Any task. Coalesces: the flush happens PREFS_COALESCE_MS after the first unsaved change.
+static void settingsChanged() {
+  uint32_t none = 0;
+  prefsDueMs.compare_exchange_strong(none, (millis() + PREFS_COALESCE_MS) | 1u);
+}
 
-  for (int i = 0; i < W_COUNT; i++) {
-    char kE[8], kN[8], kX[8];
-    snprintf(kE, sizeof(kE), "w%de", i);
-    snprintf(kN, sizeof(kN), "w%dn", i);
-    snprintf(kX, sizeof(kX), "w%dx", i);
-    prefs.putBool(kE, warnCfg[i].enabled);
-    prefs.putFloat(kN, warnCfg[i].minV);
-    prefs.putFloat(kX, warnCfg[i].maxV);
+static void prefsTask(void*) {
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(PREFS_TASK_PERIOD_MS));
+    uint32_t due = prefsDueMs.load();
+    if (due == 0 || (int32_t)(millis() - due) < 0) continue;
+    if (prefsDueMs.compare_exchange_strong(due, 0)) prefsFlush();
   }
-  prefs.end();
 }
 
-
 // Reset warnings to defaults and persist
 static void resetWarningsToDefaults() {
   defaultsWarn();
-  // Persist only warning keys (keep other settings unchanged)
-  prefs.begin("espdash", false);
-  for (int i = 0; i < W_COUNT; i++) {
-    char kE[8], kN[8], kX[8];
-    snprintf(kE, sizeof(kE), "w%de", i);
-    snprintf(kN, sizeof(kN), "w%dn", i);
-    snprintf(kX, sizeof(kX), "w%dx", i);
-    prefs.putBool(kE, warnCfg[i].enabled);
-    prefs.putFloat(kN, warnCfg[i].minV);
-    prefs.putFloat(kX, warnCfg[i].maxV);
-  }
-  prefs.end();
+  settingsChanged();
 }
 
-
 // Default confirmation popup helpers
 typedef struct {
   lv_obj_t* mbox;
   bool apply;
 } DefaultActionCtx;
 
-static void default_action_timer(lv_timer_t* t) {
-  DefaultActionCtx* ctx = (DefaultActionCtx*)t->user_data;
-  if (ctx) {
-    if (ctx->apply) {
-      resetWarningsToDefaults();   // writes hard-coded defaults to Preferences
-      refresh_settings_list();     // redraw settings UI to match prefs
-      flashSavedMsg("DEFAULT");
+static void default_action_timer(lv_timer_t* t) {
+  DefaultActionCtx* ctx = (DefaultActionCtx*)t->user_data;
+  if (ctx) {
+    if (ctx->apply) {
+      resetWarningsToDefaults();   // hard-coded defaults, saved by prefsTask
+      refresh_settings_list();     // redraw settings UI to match prefs
+      flashSavedMsg("DEFAULT");
+    }
+    if (ctx->mbox) lv_obj_del_async(ctx->mbox);
+    // Release any stuck touch/press state (common after msgbox clicks)
+    lv_indev_t* indev = lv_indev_get_act();
+    if (indev) lv_indev_reset(indev, NULL);
+    free(ctx);
+  }
+  lv_timer_del(t);
+}
+
+static void default_confirm_cb(lv_event_t* e) {
+  lv_obj_t* mbox = (lv_obj_t*)lv_event_get_user_data(e);
+  const char* txt = lv_msgbox_get_active_btn_text(mbox);
+  if (!txt) return;
+
+  bool apply = (strcmp(txt, "Yes") == 0);
+
+  DefaultActionCtx* ctx = (DefaultActionCtx*)malloc(sizeof(DefaultActionCtx));
+  if (!ctx) { if (mbox) lv_obj_del_async(mbox); return; }
+  ctx->mbox = mbox;
+  ctx->apply = apply;
+
+  lv_timer_t* t = lv_timer_create(default_action_timer, 1, ctx);
+  lv_timer_set_repeat_count(t, 1);
+}
+static void mbox_default_deleted_cb(lv_event_t* e) {
+  if (lv_event_get_code(e) != LV_EVENT_DELETE) return;
+  mbox_default = nullptr;
+}
+
+static void showDefaultConfirm() {
+  if (mbox_default) return;
+  static const char* btns[] = {"No", "Yes", ""};
+
+  // Create on the current screen so it stays in the same LVGL context
+  mbox_default = lv_msgbox_create(lv_scr_act(), "Defaults", "Reset warning alarms to default values?", btns, false);
+  lv_obj_center(mbox_default);
+  lv_obj_add_event_cb(mbox_default, mbox_default_deleted_cb, LV_EVENT_DELETE, nullptr);
+
+  // Attach callback to btnmatrix and pass msgbox as user_data
+  lv_obj_t* btnm = lv_msgbox_get_btns(mbox_default);
+  if (btnm) {
+    lv_obj_add_event_cb(btnm, default_confirm_cb, LV_EVENT_VALUE_CHANGED, mbox_default);
+  }
+}
+
+// ============================= Warning engine =============================
+// Runs in ecuMerge() for every merged frame, so alarm latency follows the data rather than
+// UI_UPDATE_MS or whether a tile happened to change. The result rides along in EcuData.warn
+// (snapshot, log queue, black box); warnMask holds the latest one for everything else.
+struct WarnState {
+  bool     active;
+  bool     pending;      // reading disagrees with `active`, since `since`
+  uint32_t since;
+  float    rateV[WARN_RATE_SLOTS];    // WS_RATE: baseline samples, oldest at rateHead once full
+  uint32_t rateMs[WARN_RATE_SLOTS];
+  uint8_t  rateHead, rateN;
+};
+static WarnState warnState[W_COUNT];   // ecuMerge() only
+
+// Channels outside `fresh` (their source went stale) clear their warnings and rate windows.
+static uint16_t warnEval(const EcuData& d, ChMask fresh) {
+  const uint32_t now = d.lastUpdateMs;
+  uint16_t mask = 0;
+  for (int w = 0; w < W_COUNT; w++) {
+    const WarnRule& r = WARN_RULES[w];
+    const WarnCfg& c = warnCfg[w];
+    WarnState& s = warnState[w];
+    if (!(fresh & chBit(r.ch))) { s = WarnState(); continue; }
+    float v = chValue(d, r.ch);
+    if (r.signal == WS_RATE) {
+      // Slope against the oldest baseline sample, every frame; the baseline slides along in
+      // WARN_RATE_WINDOW_MS / WARN_RATE_SLOTS steps, so no window boundary adds latency.
+      const uint8_t newest = (uint8_t)((s.rateHead + WARN_RATE_SLOTS - 1) % WARN_RATE_SLOTS);
+      if (s.rateN == 0 || now - s.rateMs[newest] >= WARN_RATE_WINDOW_MS / WARN_RATE_SLOTS) {
+        s.rateV[s.rateHead] = v;
+        s.rateMs[s.rateHead] = now;
+        s.rateHead = (uint8_t)((s.rateHead + 1) % WARN_RATE_SLOTS);
+        if (s.rateN < WARN_RATE_SLOTS) s.rateN++;
+      }
+      if (s.rateN < WARN_RATE_SLOTS) continue;   // baseline doesn't span the window yet
+      v = (v - s.rateV[s.rateHead]) * 1000.0f / (float)(now - s.rateMs[s.rateHead]);
+    }
+    if (!c.enabled) { s.active = s.pending = false; continue; }
+
+    const float band = s.active ? r.hyst : 0.0f;
+    const bool out = v < c.minV + band || v > c.maxV - band;
+    if (out == s.active) {
+      s.pending = false;
+    } else if (!s.pending) {
+      s.pending = true;
+      s.since = now;
+    }
+    if (s.pending && now - s.since >= (s.active ? r.offMs : r.onMs)) {
+      s.active = out;
+      s.pending = false;
+    }
+    if (s.active) mask |= (uint16_t)(1u << w);
+  }
+  return mask;
+}
+
+// Warnings that concern a channel (a tile turns red for any of them).
+static uint16_t warnBitsFor(uint8_t ch) {
+  uint16_t m = 0;
+  for (int w = 0; w < W_COUNT; w++) if (WARN_RULES[w].ch == ch) m |= (uint16_t)(1u << w);
+  return m;
+}
+
+// ============================= Binary record format =============================
+// Shared by .bin logs and the /live WebSocket.
+// File = BinLogHeader, channelCount x BinLogChannel, then fixed-size records.
+// The channel table makes the file self-describing: handleDownload() turns it back into CSV.
+// v2 records are u32 ms followed by every CHANNELS entry at its native width (bits as 0/1 bytes).
+// v3 keeps the v2 table but delta-codes the records (see binDeltaWrite()).
+// v1 files (fixed 10-column record, 14-byte channel entries, no mul/bias) are still readable.
+struct __attribute__((packed)) BinLogHeader {
+  char     magic[4];      // "EDLG"
+  uint8_t  version;
+  uint8_t  channelCount;
+  uint16_t recordSize;
+  uint32_t startMs;
+};
+
+struct __attribute__((packed)) BinLogChannel {
+  char    name[10];
+  uint8_t type;      // ChType (CT_U8..CT_BIT)
+  uint8_t offset;    // byte offset inside a record
+  uint8_t decimals;  // value = (raw * mul + bias) / 10^decimals
+  uint8_t bit;       // CT_BIT only
+  int16_t mul;       // v2+
+  int16_t bias;      // v2+
+};
+static const size_t BIN_LOG_CHANNEL_V1_SIZE = 14;
+
+static const uint8_t BIN_LOG_VERSION = 2;
+static const uint8_t BIN_LOG_VERSION_DELTA = 3;   // v2 table, delta-coded body (see binDeltaWrite)
+static const uint8_t BIN_TAG_KEY = 'K';
+static const uint8_t BIN_TAG_DELTA = 'D';
+static const uint8_t BIN_KEY_SYNC[4] = { BIN_TAG_KEY, 0xA5, 0x5A, 0xC3 };   // starts every keyframe
+static const uint16_t LOG_KEYFRAME_EVERY = 100;
+static const uint8_t BIN_LOG_CHANNEL_COUNT = CH_COUNT + 1; // + ms
+
+static constexpr uint8_t binLogStoreType(uint8_t t) { return t == CT_AFR ? (uint8_t)CT_U16 : t; }
+static constexpr int binLogRecordSize() {
+  int n = 4;
+  for (int i = 0; i < CH_COUNT; i++) n += chWidth(binLogStoreType(CHANNELS[i].type));
+  return n;
+}
+static constexpr int BIN_LOG_RECORD_SIZE = binLogRecordSize();
+static constexpr size_t BIN_LOG_PREAMBLE_SIZE = sizeof(BinLogHeader) + BIN_LOG_CHANNEL_COUNT * sizeof(BinLogChannel);
+static constexpr size_t BIN_DELTA_MASK_BYTES = (CH_COUNT + 7) / 8;
+
+// Byte offset of every CHANNELS entry inside a record (after the u32 ms).
+struct BinLogLayout { uint8_t off[CH_COUNT]; };
+static constexpr BinLogLayout binLogLayout() {
+  BinLogLayout l{};
+  int n = 4;
+  for (int i = 0; i < CH_COUNT; i++) { l.off[i] = (uint8_t)n; n += chWidth(binLogStoreType(CHANNELS[i].type)); }
+  return l;
+}
+static constexpr BinLogLayout BIN_LOG_LAYOUT = binLogLayout();
+
+static int32_t binLogGet(const uint8_t* rec, uint8_t type, uint8_t offset, uint8_t bit) {
+  const uint8_t* p = rec + offset;
+  switch (type) {
+    case CT_U8:  return p[0];
+    case CT_S8:  return (int8_t)p[0];
+    case CT_U16: return u16le(p);
+    case CT_S16: return (int16_t)u16le(p);
+    case CT_U32: return (int32_t)((uint32_t)u16le(p) | ((uint32_t)u16le(p + 2) << 16));
+    case CT_BIT: return (p[0] >> bit) & 1;
+    default:     return 0;
+  }
+}
+static int32_t binLogRead(const uint8_t* rec, const BinLogChannel& c) { return binLogGet(rec, c.type, c.offset, c.bit); }
+
+// Inverse of binLogRead() for the delta decoder (CT_BIT columns hold 0/1 bytes).
+static void binLogPut(uint8_t* rec, const BinLogChannel& c, int32_t v) {
+  uint8_t* p = rec + c.offset;
+  const uint8_t w = (c.type == CT_BIT) ? 1 : chWidth(c.type);
+  for (uint8_t i = 0; i < w; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static inline int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+static size_t varintPut(uint8_t* out, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) { out[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+// Returns bytes consumed, 0 if the varint runs past end or is longer than 5 bytes.
+static size_t varintGet(const uint8_t* p, const uint8_t* end, uint32_t& v) {
+  v = 0;
+  for (size_t n = 0; n < 5 && p + n < end; n++) {
+    v |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+    if (!(p[n] & 0x80)) return n + 1;
+  }
+  return 0;
+}
+
+// Header + channel table (BIN_LOG_PREAMBLE_SIZE bytes). Also the first message on /live.
+static void binLogPreamble(uint8_t* out, uint32_t startMs) {
+  BinLogHeader h;
+  memcpy(h.magic, "EDLG", 4);
+  h.version = BIN_LOG_VERSION;
+  h.channelCount = BIN_LOG_CHANNEL_COUNT;
+  h.recordSize = BIN_LOG_RECORD_SIZE;
+  h.startMs = startMs;
+  memcpy(out, &h, sizeof(h));
+  out += sizeof(h);
+
+  BinLogChannel c{};
+  strncpy(c.name, "ms", sizeof(c.name));
+  c.type = CT_U32; c.offset = 0; c.mul = 1;
+  memcpy(out, &c, sizeof(c));
+  out += sizeof(c);
+  for (int i = 0; i < CH_COUNT; i++) {
+    const ChannelDesc& d = CHANNELS[i];
+    c = BinLogChannel{};
+    strncpy(c.name, d.name, sizeof(c.name));
+    c.type = binLogStoreType(d.type);
+    c.offset = BIN_LOG_LAYOUT.off[i];
+    c.decimals = d.dec;
+    c.mul = d.mul;
+    c.bias = d.bias;
+    memcpy(out, &c, sizeof(c));
+    out += sizeof(c);
+  }
+}
+
+// One record: u32 ms, then every channel at its stored width (little-endian).
+static void binLogPack(const EcuData& ecu, uint32_t ms, uint8_t* r) {
+  memcpy(r, &ms, 4);
+  int off = 4;
+  for (int i = 0; i < CH_COUNT; i++) {
+    const uint8_t t = binLogStoreType(CHANNELS[i].type);
+    const int32_t v = ecu.raw[i];
+    if (chWidth(t) == 2) { r[off] = (uint8_t)v; r[off + 1] = (uint8_t)(v >> 8); off += 2; }
+    else                 { r[off++] = (uint8_t)v; }
+  }
+}
+
+// Inverse of binLogPack(); returns the record's ms.
+static uint32_t binLogUnpack(const uint8_t* r, EcuData& ecu) {
+  uint32_t ms;
+  memcpy(&ms, r, 4);
+  for (int i = 0; i < CH_COUNT; i++) ecu.raw[i] = binLogGet(r, binLogStoreType(CHANNELS[i].type), BIN_LOG_LAYOUT.off[i], 0);
+  ecu.lastUpdateMs = ms;
+  return ms;
+}
+
+// ============================= Black box =============================
+#if USE_SD
+// The last seconds of full-rate frames, kept in PSRAM as packed .bin records (plus the
+// frame's warning mask) whether or not REC is on. ecuMerge() is the only writer: it fills slot bbHead % bbCap, then publishes bbHead.
+// startRecording() copies the ring into the new log (see bbDumpChunk), so a log begins with
+// the lead-up to whatever made someone press REC, or to the warning that auto-started it.
+static const uint32_t BB_CAPACITY = 2000;   // records: 20 s at the 100 Hz poll cap, ~90 kB
+static const uint32_t BB_GUARD = 200;       // dump stays this far ahead of the writer (2 s at 100 Hz)
+static const size_t BB_SLOT = BIN_LOG_RECORD_SIZE + sizeof(uint16_t);
+static uint8_t* bbRing = nullptr;
+static uint32_t bbCap = 0;                  // 0: no PSRAM, black box off
+static std::atomic<uint32_t> bbHead{0};     // records ever written
+
+static inline uint8_t* bbSlot(uint32_t i) { return bbRing + (i % bbCap) * BB_SLOT; }
+
+static uint32_t bbRead(uint32_t i, EcuData& d) {
+  const uint8_t* s = bbSlot(i);
+  const uint32_t ms = binLogUnpack(s, d);
+  memcpy(&d.warn, s + BIN_LOG_RECORD_SIZE, sizeof(d.warn));
+  return ms;
+}
+
+static void bbSetup() {
+  bbRing = (uint8_t*)heap_caps_malloc(BB_CAPACITY * BB_SLOT, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  bbCap = bbRing ? BB_CAPACITY : 0;
+  if (!bbRing) DBG_PRINTF("[BB] no PSRAM, black box disabled\n");
+}
+
+// Called from ecuMerge() for every merged frame.
+static void bbPush(const EcuData& d) {
+  if (!bbCap) return;
+  const uint32_t h = bbHead.load(std::memory_order_relaxed);
+  uint8_t* s = bbSlot(h);
+  binLogPack(d, d.lastUpdateMs, s);
+  memcpy(s + BIN_LOG_RECORD_SIZE, &d.warn, sizeof(d.warn));
+  bbHead.store(h + 1, std::memory_order_release);
+}
+#endif
+
+// ============================= SD logging =============================
+#if USE_SD
+// Samples are staged in RAM and written in whole 512 B sectors (up to LOG_STAGE_SIZE at once),
+// so the SD/FAT layer sees a few large aligned writes instead of ~20 small print() calls.
+static const size_t LOG_SECTOR = 512;
+static const size_t LOG_STAGE_SIZE = 4096;
+static uint8_t* logStage = nullptr;
+static size_t logStageLen = 0;
+
+// ext is a 3-letter lowercase extension without the dot.
+static bool endsWithExt(const char* name, const char* ext) {
+  if (!name) return false;
+  size_t n = strlen(name);
+  if (n < 4) return false;
+  return (name[n-4] == '.' && (name[n-3] | 0x20) == ext[0] && (name[n-2] | 0x20) == ext[1] && (name[n-1] | 0x20) == ext[2]);
+}
+static bool endsWithCsv(const char* name) { return endsWithExt(name, "csv"); }
+static bool endsWithBin(const char* name) { return endsWithExt(name, "bin"); }
+
+static const char* logExt(uint8_t fmt) { return (fmt == LOG_FMT_CSV) ? "csv" : "bin"; }
+
+static String makeLogFilename(uint8_t fmt) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "/log_%05lu.%s", (unsigned long)setting_logIndex, logExt(fmt));
+  return String(buf);
+}
+
+// Write out whole sectors (or everything, when closing) and keep the tail staged.
+// Caller holds sdMutex.
+static void logStageDrain(bool all) {
+  size_t n = all ? logStageLen : (logStageLen & ~(LOG_SECTOR - 1));
+  if (n == 0 || !logFile) return;
+  logFile.write(logStage, n);
+  logStageLen -= n;
+  if (logStageLen) memmove(logStage, logStage + n, logStageLen);
+}
+
+static void logStageAppend(const void* data, size_t n) {
+  if (logStageLen + n > LOG_STAGE_SIZE) logStageDrain(false);
+  if (logStageLen + n > LOG_STAGE_SIZE) return; // n larger than a sector; never happens for our records
+  memcpy(logStage + logStageLen, data, n);
+  logStageLen += n;
+}
+
+// Called with an empty stage (startRecording).
+static void writeBinLogHeader(uint8_t version, uint32_t startMs) {
+  static_assert(BIN_LOG_PREAMBLE_SIZE <= LOG_STAGE_SIZE, "log stage too small for the .bin preamble");
+  binLogPreamble(logStage + logStageLen, startMs);
+  ((BinLogHeader*)(logStage + logStageLen))->version = version;
+  logStageLen += BIN_LOG_PREAMBLE_SIZE;
+}
+
+// ---- delta-coded records (BIN_LOG_VERSION_DELTA) ----
+// Same header and channel table as v2, but the body is a tagged stream:
+//   BIN_KEY_SYNC ('K' ...) + full record + u32 CRC32(record)      keyframe
+//   'D' + u16 dMs + change mask (1 bit per non-ms column) + zigzag varint delta per set bit
+// A keyframe is forced every LOG_KEYFRAME_EVERY records and whenever dMs doesn't fit. A 'D'
+// record can contain the sync bytes too, but not with a matching CRC behind them, so a reader
+// can start anywhere (a Range, a damaged record) by scanning for the next valid keyframe.
+// Slow channels (temps, warmup, launch, bits) cost one mask bit per record instead of a field.
+static uint8_t logDeltaPrev[BIN_LOG_RECORD_SIZE];
+static uint32_t logDeltaPrevMs = 0;
+static uint16_t logDeltaSinceKey = 0;   // 0: next record is a keyframe
+
+static const size_t BIN_DELTA_MAX = 3 + BIN_DELTA_MASK_BYTES + CH_COUNT * 5;
+
+// One 'D' record for r against prev into out (BIN_DELTA_MAX bytes); returns its length.
+static size_t binDeltaEncode(const uint8_t* r, const uint8_t* prev, uint16_t dMs, uint8_t* out) {
+  out[0] = BIN_TAG_DELTA;
+  out[1] = (uint8_t)dMs;
+  out[2] = (uint8_t)(dMs >> 8);
+  uint8_t* mask = out + 3;
+  memset(mask, 0, BIN_DELTA_MASK_BYTES);
+  size_t n = 3 + BIN_DELTA_MASK_BYTES;
+  for (int i = 0; i < CH_COUNT; i++) {
+    const uint8_t t = binLogStoreType(CHANNELS[i].type), off = BIN_LOG_LAYOUT.off[i];
+    const int32_t d = binLogGet(r, t, off, 0) - binLogGet(prev, t, off, 0);
+    if (d == 0) continue;
+    mask[i >> 3] |= (uint8_t)(1u << (i & 7));
+    n += varintPut(out + n, zigzag(d));
+  }
+  return n;
+}
+
+static void binDeltaWrite(const EcuData& ecu, uint32_t ms) {
+  uint8_t r[BIN_LOG_RECORD_SIZE];
+  binLogPack(ecu, ms, r);
+  const uint32_t dMs = ms - logDeltaPrevMs;
+  if (logDeltaSinceKey == 0 || dMs > 0xFFFF) {
+    const uint32_t c = crc32(r, sizeof(r));
+    const uint8_t crc[4] = { (uint8_t)c, (uint8_t)(c >> 8), (uint8_t)(c >> 16), (uint8_t)(c >> 24) };
+    logStageAppend(BIN_KEY_SYNC, sizeof(BIN_KEY_SYNC));
+    logStageAppend(r, sizeof(r));
+    logStageAppend(crc, sizeof(crc));
+    logDeltaSinceKey = LOG_KEYFRAME_EVERY;
+  } else {
+    uint8_t out[BIN_DELTA_MAX];
+    logStageAppend(out, binDeltaEncode(r, logDeltaPrev, (uint16_t)dMs, out));
+    logDeltaSinceKey--;
+  }
+  memcpy(logDeltaPrev, r, sizeof(r));
+  logDeltaPrevMs = ms;
+}
+
+static void writeCsvLogHeader() {
+  char line[384];
+  int n = snprintf(line, sizeof(line), "ms");
+  for (int i = 0; i < CH_COUNT && n < (int)sizeof(line); i++)
+    n += snprintf(line + n, sizeof(line) - n, ",%s", CHANNELS[i].name);
+  n += snprintf(line + n, sizeof(line) - n, "\r\n");
+  logStageAppend(line, min((size_t)n, sizeof(line) - 1));
+}
+
+static inline void sdLock()   { if (sdMutex) xSemaphoreTakeRecursive(sdMutex, portMAX_DELAY); }
+static inline void sdUnlock() { if (sdMutex) xSemaphoreGiveRecursive(sdMutex); }
+
+static void logWriteSample(const EcuData& ecu, uint32_t ms);
+
+// ---- session index (/logs.idx) ----
+// One fixed-size LogIndexEntry per recording. startRecording() appends it with LIDX_OPEN,
+// stopRecording() rewrites it in place, so /logs and /downloadLatest never scan the root
+// directory. logIndexCheck() (boot) rebuilds a missing/corrupt index from one root scan
+// and closes entries that a power loss left open.
+static const char* LOG_INDEX_PATH = "/logs.idx";
+static const uint8_t LIDX_OPEN     = 1 << 0;   // recording (or interrupted by power loss)
+static const uint8_t LIDX_NO_STATS = 1 << 1;   // recovered: duration/RPM/AFR unknown
+static const uint8_t LIDX_PREALLOC = 1 << 2;   // file was reserved up front; size = bytes written
+static const uint8_t LIDX_AUTO     = 1 << 3;   // started by the black box trigger, not REC
+static const uint8_t LIDX_CAP      = 1 << 4;   // has a .cap raw capture next to it
+
+struct __attribute__((packed)) LogIndexEntry {
+  char     name[16];     // "/log_00001.csv"
+  uint32_t size;         // bytes
+  uint32_t startMs;      // millis() at REC (no RTC)
+  uint32_t durationMs;
+  uint16_t maxRpm;
+  int16_t  minAfrX100;   // INT16_MAX: no AFR sample
+  uint8_t  fmt;          // LogFormat
+  uint8_t  flags;        // LIDX_*
+  uint16_t reserved;
+};
+
+static uint32_t logIndexCount = 0;   // entries in LOG_INDEX_PATH (sdMutex)
+static LogIndexEntry logSess{};      // entry of the running session (sdMutex)
+static uint32_t logSessPos = UINT32_MAX;   // its slot in the index, UINT32_MAX: not indexed
+
+// Caller holds sdMutex. pos == logIndexCount appends.
+static bool logIndexWrite(uint32_t pos, const LogIndexEntry& e) {
+  File f = SD.open(LOG_INDEX_PATH, pos >= logIndexCount ? FILE_APPEND : "r+");
+  if (!f) return false;
+  bool ok = f.seek(pos * sizeof(e)) && f.write((const uint8_t*)&e, sizeof(e)) == sizeof(e);
+  f.close();
+  if (ok && pos >= logIndexCount) logIndexCount = pos + 1;
+  return ok;
+}
+
+// Reads up to n entries starting at pos; returns how many. Caller holds sdMutex.
+static size_t logIndexRead(uint32_t pos, LogIndexEntry* out, size_t n) {
+  File f = SD.open(LOG_INDEX_PATH, FILE_READ);
+  if (!f) return 0;
+  size_t got = 0;
+  if (f.seek(pos * sizeof(LogIndexEntry))) got = f.read((uint8_t*)out, n * sizeof(LogIndexEntry)) / sizeof(LogIndexEntry);
+  f.close();
+  return got;
+}
+
+// "/log_00001.csv" -> "/log_00001.<ext>" (.sum summary, .cap raw capture)
+static void logSiblingPath(const char* logPath, const char* ext, char* out, size_t outSz) {
+  snprintf(out, outSz, "%s", logPath);
+  const size_t n = strlen(out);
+  if (n > 4) snprintf(out + n - 3, outSz - (n - 3), "%s", ext);
+}
+
+static void logTruncate(const char* path, uint32_t len);
+
+// A preallocated log cut short by power loss still has its full reserved size on disk; if
+// its (last, open) entry survived, the file is first cut back to the checkpointed length.
+static void logIndexRebuild() {
+  File old = SD.open(LOG_INDEX_PATH, FILE_READ);
+  const uint32_t oldCount = old ? old.size() / sizeof(LogIndexEntry) : 0;
+  if (old) old.close();
+  LogIndexEntry last;
+  if (oldCount && logIndexRead(oldCount - 1, &last, 1) == 1 &&
+      (last.flags & (LIDX_OPEN | LIDX_PREALLOC)) == (LIDX_OPEN | LIDX_PREALLOC)) {
+    last.name[sizeof(last.name) - 1] = 0;
+    logTruncate(last.name, last.size);
+  }
+  SD.remove(LOG_INDEX_PATH);
+  logIndexCount = 0;
+  File root = SD.open("/");
+  if (!root) return;
+  for (File f = root.openNextFile(); f; f = root.openNextFile()) {
+    const char* n = f.name();
+    const char* base = (n && n[0] == '/') ? n + 1 : n;
+    if (!f.isDirectory() && base && strncmp(base, "log_", 4) == 0 && (endsWithCsv(base) || endsWithBin(base))) {
+      LogIndexEntry e{};
+      snprintf(e.name, sizeof(e.name), "/%s", base);
+      e.size = f.size();
+      e.minAfrX100 = INT16_MAX;
+      e.fmt = endsWithBin(base) ? LOG_FMT_BIN : LOG_FMT_CSV;
+      e.flags = LIDX_NO_STATS;
+      char capPath[32];
+      logSiblingPath(e.name, "cap", capPath, sizeof(capPath));
+      if (SD.exists(capPath)) e.flags |= LIDX_CAP;
+      logIndexWrite(logIndexCount, e);
+    }
+    f.close();
+  }
+  root.close();
+}
+
+// ---- preallocated log files ----
+// With setting_logPreallocMb > 0 the file is created as one contiguous cluster chain
+// (f_expand via esp_vfs_fat_create_contiguous_file) and then overwritten from offset 0,
+// so recording never has to allocate clusters or touch the FAT. Its size is checkpointed in
+// the index every LOG_FLUSH_MS and the file is truncated to it on stop (or at the next boot).
+// Writing past the reservation just falls back to normal allocation.
+static bool logPreallocate(const char* path, uint32_t mb) {
+  char full[48];
+  snprintf(full, sizeof(full), "%s%s", SD_MOUNT, path);
+  SD.remove(path);
+  const esp_err_t err = esp_vfs_fat_create_contiguous_file(SD_MOUNT, full, (uint64_t)mb << 20, true);
+  if (err != ESP_OK) DBG_PRINTF("SD: preallocating %lu MB failed (%s), using a normal file\n", (unsigned long)mb, esp_err_to_name(err));
+  return err == ESP_OK;
+}
+
+static void logTruncate(const char* path, uint32_t len) {
+  char full[48];
+  snprintf(full, sizeof(full), "%s%s", SD_MOUNT, path);
+  truncate(full, len);
+}
+
+// Boot: validate the index, rebuild it if needed, and close sessions cut short by power loss.
+static void logIndexCheck() {
+  sdLock();
+  File f = SD.open(LOG_INDEX_PATH, FILE_READ);
+  const size_t size = f ? f.size() : 0;
+  if (f) f.close();
+  if (!f || size % sizeof(LogIndexEntry) != 0) {
+    logIndexRebuild();
+  } else {
+    logIndexCount = size / sizeof(LogIndexEntry);
+    // Only the last entry can be open (one session at a time). A preallocated file is cut
+    // back to the last checkpointed length; anything after it is unwritten reservation.
+    LogIndexEntry e;
+    if (logIndexCount && logIndexRead(logIndexCount - 1, &e, 1) == 1 && (e.flags & LIDX_OPEN)) {
+      if (e.flags & LIDX_PREALLOC) {
+        logTruncate(e.name, e.size);
+      } else {
+        File lf = SD.open(e.name, FILE_READ);
+        e.size = lf ? lf.size() : 0;
+        if (lf) lf.close();
+      }
+      e.flags = (e.flags & ~LIDX_OPEN) | LIDX_NO_STATS;
+      logIndexWrite(logIndexCount - 1, e);
+    }
+  }
+
+  // Next log number: past every indexed log, even if NVS holds an older value.
+  LogIndexEntry page[16];
+  for (uint32_t i = 0; i < logIndexCount; i += 16) {
+    const size_t n = logIndexRead(i, page, 16);
+    for (size_t j = 0; j < n; j++) {
+      unsigned long idx = 0;
+      if (sscanf(page[j].name, "/log_%lu.", &idx) == 1 && idx >= setting_logIndex) setting_logIndex = idx + 1;
+    }
+    if (n == 0) break;
+  }
+  sdUnlock();
+}
+
+// ---- session summary (/log_NNNNN.sum) ----
+// Running aggregates over every logged sample, O(CH_COUNT) per sample: min/max/sum per
+// channel (fixed point, as in the CSV), time spent outside each enabled warnCfg window, and
+// an RPM x AFR sample histogram. stopRecording() writes it next to the log; /summary shows
+// it (live from RAM for the running session) and the dash toasts the headline numbers.
+static const uint8_t  SUM_VERSION     = 1;
+static const uint8_t  SUM_RPM_BINS    = 16;     // 500 rpm wide, last one open-ended
+static const uint16_t SUM_RPM_BIN     = 500;
+static const uint8_t  SUM_AFR_BINS    = 12;     // 0.5 AFR wide from 10.0, first/last open-ended
+static const int32_t  SUM_AFR_LO_X100 = 1000;
+static const int32_t  SUM_AFR_BIN_X100 = 50;
+static const uint32_t SUM_MAX_GAP_MS  = 1000;   // longer gaps between samples don't count as warn time
+
+// Naturally aligned (not packed): only this firmware reads it back, after checking version/counts.
+struct LogSummary {
+  char     magic[4];    // "EDSM"
+  uint8_t  version;
+  uint8_t  chCount;     // CH_COUNT when written
+  uint8_t  warnCount;   // W_COUNT when written
+  uint8_t  reserved;
+  uint32_t samples;
+  uint32_t durationMs;
+  int32_t  chMin[CH_COUNT];
+  int32_t  chMax[CH_COUNT];
+  int64_t  chSum[CH_COUNT];
+  uint32_t warnMs[W_COUNT];
+  uint16_t hist[SUM_RPM_BINS][SUM_AFR_BINS];   // samples (saturating); AFR <= 0 not counted
+};
+
+static LogSummary logSum;          // running session (sdMutex)
+static LogSummary logSumLast;      // last closed session, for the dash toast (sdMutex)
+static uint32_t logSumLastMs = 0;
+
+static void logSumReset() {
+  memset(&logSum, 0, sizeof(logSum));
+  memcpy(logSum.magic, "EDSM", 4);
+  logSum.version = SUM_VERSION;
+  logSum.chCount = CH_COUNT;
+  logSum.warnCount = W_COUNT;
+  for (int i = 0; i < CH_COUNT; i++) { logSum.chMin[i] = INT32_MAX; logSum.chMax[i] = INT32_MIN; }
+}
+
+// Per-sample session stats. Caller holds sdMutex.
+static void logSessUpdate(const EcuData& ecu, uint32_t ms) {
+  const int32_t rpm = chFixed(ecu, CH_RPM);
+  const int32_t afr = chFixed(ecu, CH_AFR);
+  if (rpm > logSess.maxRpm) logSess.maxRpm = (uint16_t)min(rpm, (int32_t)UINT16_MAX);
+  if (afr > 0 && afr < logSess.minAfrX100) logSess.minAfrX100 = (int16_t)afr;
+
+  for (int i = 0; i < CH_COUNT; i++) {
+    const int32_t v = chFixed(ecu, i);
+    if (v < logSum.chMin[i]) logSum.chMin[i] = v;
+    if (v > logSum.chMax[i]) logSum.chMax[i] = v;
+    logSum.chSum[i] += v;
+  }
+
+  if (logSum.samples) {
+    const uint32_t dt = min(ms - logSumLastMs, SUM_MAX_GAP_MS);
+    for (int w = 0; w < W_COUNT; w++) {
+      if (ecu.warn & (1u << w)) logSum.warnMs[w] += dt;
+    }
+  }
+  logSumLastMs = ms;
+  logSum.samples++;
+
+  if (afr > 0) {
+    const int rb = min((int)(max(rpm, (int32_t)0) / SUM_RPM_BIN), SUM_RPM_BINS - 1);
+    const int ab = (afr < SUM_AFR_LO_X100) ? 0 : min((int)((afr - SUM_AFR_LO_X100) / SUM_AFR_BIN_X100) + 1, SUM_AFR_BINS - 1);
+    uint16_t& h = logSum.hist[rb][ab];
+    if (h != UINT16_MAX) h++;
+  }
+}
+
+// ---- black box dump ----
+// startRecording() marks ring records [bbDumpFrom, bbDumpTo) for the new log; logTask writes
+// them BB_DUMP_CHUNK at a time ahead of any live sample. If the writer gets within BB_GUARD
+// of the oldest pending record, those records are skipped rather than read while rewritten.
+// bbPush() runs before logPushFrame(), so a frame can land in both the dump and logQueue;
+// queued frames not newer than bbDumpEndMs are dropped.
+static const uint32_t BB_DUMP_CHUNK = 100;
+static uint32_t bbDumpFrom = 0, bbDumpTo = 0;   // sdMutex
+static uint32_t bbDumpEndMs = 0;
+static bool bbDedupe = false;
+// Set by stopRecording() while a dump is still pending: logTask writes the rest of it, then
+// closes the log (logFinish). A new recording waits for that.
+static volatile bool logClosing = false;   // sdMutex
+
+// Caller holds sdMutex.
+static void bbDumpChunk() {
+  const uint32_t h = bbHead.load(std::memory_order_acquire);
+  const uint32_t span = bbCap - BB_GUARD;
+  if (h - bbDumpFrom > span) bbDumpFrom = min(h - span, bbDumpTo);
+  for (uint32_t n = 0; n < BB_DUMP_CHUNK && bbDumpFrom != bbDumpTo; n++, bbDumpFrom++) {
+    EcuData d;
+    const uint32_t ms = bbRead(bbDumpFrom, d);
+    logWriteSample(d, ms);
+  }
+}
+
+// Caller holds sdMutex.
+static void logWriteFrame(const EcuData& d) {
+  if (bbDedupe && (int32_t)(d.lastUpdateMs - bbDumpEndMs) <= 0) return;
+  logWriteSample(d, d.lastUpdateMs);
+}
+
+// ---- raw capture (/log_NNNNN.cap) ----
+// With setting_logRawCap, REC also keeps every byte acqTask takes off ECU_SERIAL, so a later
+// decoder (new channels, another AFR format) can be rerun over the session with /replay.
+// File = CapHeader, then one record per bulk UART read: u16 dMs since the previous record
+// (saturating), u16 n, and the n bytes exactly as onRxBytes() got them.
+// acqTask copies each read into capRing whole or not at all (capDrops); logTask writes the
+// ring out CAP_WRITE_BLOCK at a time, so the receive path never waits on the SD card.
+struct __attribute__((packed)) CapHeader {
+  char     magic[4];   // "EDCP"
+  uint8_t  version;
+  uint8_t  proto;      // EcuProto the bytes are framed with
+  uint8_t  afrFmt;     // setting_afrFmt when recorded (informational: replay uses the current one)
+  uint8_t  reserved;
+  uint32_t startMs;    // millis() at REC; the first record's dMs counts from here
+};
+static const uint8_t CAP_VERSION = 1;
+static const size_t CAP_REC_HDR = 4;
+static const uint32_t CAP_RING_SIZE = 32768;   // power of two; ~6 s of 'r' replies at 100 Hz
+static const uint32_t CAP_WRITE_BLOCK = 4096;
+static uint8_t* capRing = nullptr;             // PSRAM, allocated on first use
+static std::atomic<uint32_t> capHead{0};       // free-running byte counters: acqTask writes head,
+static std::atomic<uint32_t> capTail{0};       // capDrain() (sdMutex) writes tail
+static volatile bool capOn = false;
+static volatile uint32_t capDrops = 0;         // reads lost because the ring was full
+static uint32_t capLastMs = 0;
+static File capFile;                           // sdMutex
+static char capFileName[32] = "";
+
+static void capRingPut(uint32_t at, const uint8_t* p, size_t n) {
+  const uint32_t i = at & (CAP_RING_SIZE - 1);
+  const size_t first = min((size_t)(CAP_RING_SIZE - i), n);
+  memcpy(capRing + i, p, first);
+  if (n > first) memcpy(capRing, p + first, n - first);
+}
+
+// Called from onRxBytes() on acqTask for every bulk read.
+static void capPush(const uint8_t* b, size_t n, uint32_t now) {
+  if (!capOn) return;
+  const uint32_t h = capHead.load(std::memory_order_relaxed);
+  if (CAP_RING_SIZE - (h - capTail.load(std::memory_order_acquire)) < CAP_REC_HDR + n) { capDrops = capDrops + 1; return; }
+  const uint32_t dMs = min(now - capLastMs, (uint32_t)UINT16_MAX);
+  capLastMs = now;
+  const uint8_t hdr[CAP_REC_HDR] = { (uint8_t)dMs, (uint8_t)(dMs >> 8), (uint8_t)n, (uint8_t)(n >> 8) };
+  capRingPut(h, hdr, sizeof(hdr));
+  capRingPut(h + CAP_REC_HDR, b, n);
+  capHead.store(h + CAP_REC_HDR + n, std::memory_order_release);
+}
+
+// Caller holds sdMutex. all: everything pending (flush / stop), else whole blocks only.
+static void capDrain(bool all) {
+  if (!capFile) return;
+  const uint32_t h = capHead.load(std::memory_order_acquire);
+  uint32_t t = capTail.load(std::memory_order_relaxed);
+  while (h - t >= CAP_WRITE_BLOCK || (all && h != t)) {
+    const uint32_t i = t & (CAP_RING_SIZE - 1);
+    const size_t n = min(min((size_t)(h - t), (size_t)CAP_WRITE_BLOCK), (size_t)(CAP_RING_SIZE - i));
+    capFile.write(capRing + i, n);
+    t += n;
+    capTail.store(t, std::memory_order_release);
+  }
+}
+
+// Caller holds sdMutex, logFileName is set. Returns true if a capture is running.
+static bool capStart(uint32_t now) {
+  capOn = false;
+  if (!setting_logRawCap) return false;
+  if (!capRing) capRing = (uint8_t*)heap_caps_malloc(CAP_RING_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (!capRing) { DBG_PRINTF("[CAP] no PSRAM, raw capture off\n"); return false; }
+  logSiblingPath(logFileName, "cap", capFileName, sizeof(capFileName));
+  capFile = SD.open(capFileName, FILE_WRITE);
+  if (!capFile) { capFileName[0] = 0; return false; }
+
+  CapHeader h{};
+  memcpy(h.magic, "EDCP", 4);
+  h.version = CAP_VERSION;
+  h.proto = ecuProto;
+  h.afrFmt = setting_afrFmt;
+  h.startMs = now;
+  capFile.write((const uint8_t*)&h, sizeof(h));
+  capTail.store(capHead.load(std::memory_order_acquire), std::memory_order_release);
+  capDrops = 0;
+  capLastMs = now;
+  capOn = true;
+  return true;
+}
+
+// Caller holds sdMutex.
+static void capStop() {
+  capOn = false;
+  if (!capFile) return;
+  capDrain(true);
+  capFile.close();
+  capFileName[0] = 0;
+}
+
+// Caller holds sdMutex, logFile is open and recording is off.
+static void logFinish() {
+  EcuData d;
+  while (logQueue.pop(d)) logWriteFrame(d);
+  capStop();
+  logStageDrain(true);
+  logFile.flush();
+  logSess.size = logFile.position();   // size() of a preallocated file is the reservation
+  logFile.close();
+  if (logSess.flags & LIDX_PREALLOC) logTruncate(logFileName, logSess.size);
+  logSess.flags &= ~LIDX_OPEN;
+  if (logSessPos != UINT32_MAX) logIndexWrite(logSessPos, logSess);
+  logSessPos = UINT32_MAX;
+
+  logSum.durationMs = logSess.durationMs;
+  char sumPath[32];
+  logSiblingPath(logFileName, "sum", sumPath, sizeof(sumPath));
+  File sf = SD.open(sumPath, FILE_WRITE);
+  if (sf) { sf.write((const uint8_t*)&logSum, sizeof(logSum)); sf.close(); }
+  logSumLast = logSum;
+
+  logStageLen = 0;
+  logFileName[0] = 0;
+  logClosing = false;
+  uiRequest(UI_REQ_REC_BTN | UI_REQ_SUMMARY);
+}
+
+// Any task. A black box dump still pending is left to logTask, which closes the log after it.
+static void stopRecording() {
+  sdLock();
+  if (logClosing) { sdUnlock(); return; }
+  recording = false;
+  logSess.durationMs = millis() - logSess.startMs;   // includes the prepended history
+  if (!logFile) {
+    logStageLen = 0;
+    logFileName[0] = 0;
+    sdUnlock();
+    uiRequest(UI_REQ_REC_BTN);
+    return;
+  }
+  if (bbDumpFrom != bbDumpTo) {
+    logClosing = true;
+    sdUnlock();
+    uiRequest(UI_REQ_REC_BTN);
+    return;
+  }
+  logFinish();
+  sdUnlock();
+}
+
+// Called from the REC button (render task), /rec (async_tcp) and the black box trigger
+// (logTask); sdMutex serialises them. autoRec marks the session for bbCheckTriggers().
+static volatile bool recAuto = false;
+
+static const char* startRecording(bool autoRec = false) {
+  if (!setting_logEnabled) return "Logging disabled";
+  if (!sdOk) return "SD card not detected";
+
+  sdLock();
+  if (recording) { sdUnlock(); return "Already recording"; }
+  if (logClosing) { sdUnlock(); return "Saving previous log"; }
+  if (!logStage) {
+    logStage = (uint8_t*)heap_caps_malloc(LOG_STAGE_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!logStage) logStage = (uint8_t*)malloc(LOG_STAGE_SIZE);
+    if (!logStage) { sdUnlock(); return "Out of memory"; }
+  }
+
+  // Latched once: the portal can change setting_logFmt (async_tcp) while this runs or during REC.
+  recFmt = setting_logFmt < LOG_FMT_COUNT ? setting_logFmt : (uint8_t)LOG_FMT_CSV;
+  String fn = makeLogFilename(recFmt);
+  const bool prealloc = setting_logPreallocMb > 0 && logPreallocate(fn.c_str(), setting_logPreallocMb);
+  logFile = SD.open(fn.c_str(), prealloc ? "r+" : FILE_WRITE);
+  if (!logFile) { sdUnlock(); return "Failed to open log file"; }
+  strncpy(logFileName, fn.c_str(), sizeof(logFileName) - 1);
+
+  logStageLen = 0;
+  logQueue.clear();
+  logQueueDrops = 0;
+  recEveryFrame = setting_logEveryFrame;
+  recAuto = autoRec;
+  recording = true;   // logTask waits on sdMutex; frames from here on are queued
+  // Taken after recording is set: every later ring record is also queued (or sampled).
+  bbDumpTo = bbCap ? bbHead.load(std::memory_order_acquire) : 0;
+  bbDumpFrom = bbDumpTo > bbCap - BB_GUARD ? bbDumpTo - (bbCap - BB_GUARD) : 0;
+  bbDedupe = bbDumpFrom != bbDumpTo;
+  const uint32_t now = millis();
+  uint32_t startMs = now;   // the session starts with the oldest history record
+  if (bbDedupe) {
+    EcuData rec;
+    bbDumpEndMs = bbRead(bbDumpTo - 1, rec);
+    startMs = bbRead(bbDumpFrom, rec);
+  }
+  if (recFmt != LOG_FMT_CSV) {
+    writeBinLogHeader(recFmt == LOG_FMT_BIN_DELTA ? BIN_LOG_VERSION_DELTA : BIN_LOG_VERSION, startMs);
+    logDeltaSinceKey = 0;
+  } else {
+    writeCsvLogHeader();
+  }
+  lastLogMs = 0;
+
+  logSess = LogIndexEntry{};
+  strncpy(logSess.name, logFileName, sizeof(logSess.name) - 1);
+  logSess.startMs = startMs;
+  logSess.minAfrX100 = INT16_MAX;
+  logSess.fmt = recFmt;
+  logSess.flags = LIDX_OPEN | (prealloc ? LIDX_PREALLOC : 0) | (autoRec ? LIDX_AUTO : 0) |
+                  (capStart(now) ? LIDX_CAP : 0);   // no CAN history: the capture starts now
+  logSessPos = logIndexWrite(logIndexCount, logSess) ? logIndexCount - 1 : UINT32_MAX;
+  logSumReset();
+  setting_logIndex++;
+  sdUnlock();
+  uiRequest(UI_REQ_REC_BTN);   // setting_logIndex: recovered from /logs.idx, no NVS write here
+  return nullptr;
+}
+
+// Fixed-point -> text without float formatting; returns chars written.
+static int formatFixed(char* out, size_t outSz, int32_t raw, uint8_t decimals) {
+  if (decimals == 0) return snprintf(out, outSz, "%ld", (long)raw);
+  int32_t div = 1;
+  for (uint8_t i = 0; i < decimals; i++) div *= 10;
+  const bool neg = raw < 0;
+  uint32_t a = neg ? (uint32_t)(-(int64_t)raw) : (uint32_t)raw;
+  return snprintf(out, outSz, "%s%lu.%0*lu", neg ? "-" : "", (unsigned long)(a / div), (int)decimals, (unsigned long)(a % div));
+}
+
+static const size_t CSV_LINE_MAX = 384;
+
+// One CSV row (with CRLF) into line[CSV_LINE_MAX]; returns its length.
+static size_t csvFormatSample(const EcuData& ecu, uint32_t ms, char* line) {
+  int n = snprintf(line, CSV_LINE_MAX, "%lu", (unsigned long)ms);
+  for (int i = 0; i < CH_COUNT && n < (int)CSV_LINE_MAX - 16; i++) {
+    line[n++] = ',';
+    n += formatFixed(line + n, CSV_LINE_MAX - n, chFixed(ecu, i), CHANNELS[i].dec);
+  }
+  n += snprintf(line + n, CSV_LINE_MAX - n, "\r\n");
+  return min((size_t)n, CSV_LINE_MAX - 1);
+}
+
+// Formats one sample into the staging buffer. Caller holds sdMutex.
+// Both formats are driven by CHANNELS, so a new table row shows up in the logs with no extra code.
+static void logWriteSample(const EcuData& ecu, uint32_t ms) {
+  logSessUpdate(ecu, ms);
+  if (recFmt == LOG_FMT_BIN_DELTA) {
+    binDeltaWrite(ecu, ms);
+  } else if (recFmt == LOG_FMT_BIN) {
+    uint8_t r[BIN_LOG_RECORD_SIZE];
+    binLogPack(ecu, ms, r);
+    logStageAppend(r, sizeof(r));
+  } else {
+    char line[CSV_LINE_MAX];
+    logStageAppend(line, csvFormatSample(ecu, ms, line));
+  }
+}
+
+// Called from ecuMerge() for every merged frame.
+static void logPushFrame(const EcuData& d) {
+  if (!recording || !recEveryFrame) return;
+  if (!logQueue.push(d)) logQueueDrops = logQueueDrops + 1;
+}
+
+// Runs on logTask (core 0). Interval mode samples the published snapshot; every-frame mode
+// drains logQueue and stamps each row with the frame's own receive time.
+static void logIfRecording() {
+  if (logClosing) {
+    sdLock();
+    if (logClosing) {
+      if (bbDumpFrom != bbDumpTo) bbDumpChunk();
+      else logFinish();
+      if (logClosing) capDrain(false);
+    }
+    sdUnlock();
+    return;
+  }
+  if (!recording || !sdOk) return;
+  const bool dumping = bbDumpFrom != bbDumpTo;
+  if (!dumping && !recEveryFrame && millis() - lastLogMs < LOG_INTERVAL_MS) return;
+
+  sdLock();
+  if (!recording || !logFile) { sdUnlock(); return; }
+
+  if (bbDumpFrom != bbDumpTo) {
+    bbDumpChunk();
+  } else if (recEveryFrame) {
+    EcuData d;
+    while (logQueue.pop(d)) logWriteFrame(d);
+  } else if (millis() - lastLogMs >= LOG_INTERVAL_MS) {
+    EcuData ecu;
+    ecuSnapshot(ecu);
+    lastLogMs = millis();
+    logWriteSample(ecu, lastLogMs);
+  }
+
+  capDrain(false);
+
+  static uint32_t lastFlush = 0;
+  if (millis() - lastFlush > LOG_FLUSH_MS) {
+    logStageDrain(false);
+    logFile.flush();
+    if (capFile) { capDrain(true); capFile.flush(); }
+    if ((logSess.flags & LIDX_PREALLOC) && logSessPos != UINT32_MAX) {
+      logSess.size = logFile.position();   // recovery point if power is lost
+      logIndexWrite(logSessPos, logSess);
+    }
+    lastFlush = millis();
+  }
+  sdUnlock();
+}
+
+// Runs on logTask. With setting_bbAutoRec, a warning or the shift light on a running engine
+// starts a recording (its log opens with the black box history); an auto-started recording
+// stops once nothing has triggered for BB_POST_MS. A manual REC is never stopped here.
+static const uint32_t BB_CHECK_MS = 100;
+static const uint32_t BB_POST_MS = 20000;
+
+static void bbCheckTriggers() {
+  static uint32_t lastCheck = 0, lastTrigger = 0;
+  const uint32_t now = millis();
+  if (now - lastCheck < BB_CHECK_MS) return;
+  lastCheck = now;
+  if (!setting_bbAutoRec || !linkValid) return;
+#if USE_REPLAY
+  if (replayActive) return;   // a replayed log doesn't start a new one
+#endif
+
+  EcuData ecu;
+  ecuSnapshot(ecu);
+  const int32_t rpm = chInt(ecu, CH_RPM);
+  bool trig = false;
+  if (rpm > 0 && now - ecu.lastUpdateMs < 1000) {
+    trig = ecu.warn != 0 || (setting_shiftEnabled && rpm >= setting_shiftRpm);
+  }
+
+  if (trig) {
+    lastTrigger = now;
+    if (!recording && startRecording(true) == nullptr) DBG_PRINTF("[BB] auto REC\n");
+  } else if (recording && recAuto && now - lastTrigger > BB_POST_MS) {
+    stopRecording();
+  }
+}
+
+static void logTask(void*) {
+  for (;;) {
+    {
+      PHASE_SCOPE(PH_LOG);
+      bbCheckTriggers();
+      logIfRecording();
+    }
+    vTaskDelay(pdMS_TO_TICKS(LOG_TASK_PERIOD_MS));
+  }
+}
+#endif
+
+// ============================= ECU serial open/close =============================
+// After dashSetup() these are only called from acqTask, which owns ECU_SERIAL.
+// Runs in the UART driver's event task (IDF event queue): just wake acqTask, which does the read.
+static void ecuOnReceive() {
+  if (acqTaskHandle) xTaskNotifyGive(acqTaskHandle);
+}
+
+// ============================= Poll scheduler =============================
+static void schedReset() {
+  ecuRetries = ecuRetries + reqInflight;
+  reqInflight = 0;
+  reqSentHead = reqSentTail = 0;
+}
+
+static void schedOnSend(uint32_t now) {
+  reqSentMs[reqSentHead] = now;
+  reqSentHead = (reqSentHead + 1) % R_PIPE_MAX;
+  reqInflight++;
+}
+
+// A reply finished (any reply that passed framing/CRC): pair it with the oldest request.
+static void schedOnReply(uint32_t now) {
+  if (!reqInflight) return;   // unsolicited / late: nothing to time
+  const uint32_t rtt = now - reqSentMs[reqSentTail];
+  reqSentTail = (reqSentTail + 1) % R_PIPE_MAX;
+  reqInflight--;
+  rttX16 = rttX16 - (rttX16 >> 3) + (rtt << 1);   // 1/8 weight, x16 fixed point
+
+  if (rtt < rttWin.minMs) rttWin.minMs = rtt;
+  if (rtt > rttWin.maxMs) rttWin.maxMs = rtt;
+  rttWin.sumMs += rtt;
+  rttWin.n++;
+}
+
+static void rttWindowRoll(uint32_t now) {
+  if (now - rttWin.t0 < RTT_WINDOW_MS) return;
+  rttStatMinMs = rttWin.n ? rttWin.minMs : 0;
+  rttStatMaxMs = rttWin.maxMs;
+  rttStatAvgMs = rttWin.n ? rttWin.sumMs / rttWin.n : 0;
+  rttStatN     = rttWin.n;
+  rttWin = { UINT32_MAX, 0, 0, 0, now };
+}
+
+static inline uint32_t rttAvgMs() { return (rttX16 + 8) >> 4; }
+static inline uint32_t reqTimeoutMs() {
+  return min(REQ_TIMEOUT_MAX_MS, max(REQ_TIMEOUT_MIN_MS, 3 * rttAvgMs()));
+}
+
+static void ecuSerialBegin() {
+  // The RX ring can only be sized while the driver is down (UART0 is already up for debug prints).
+  ECU_SERIAL.end();
+  ECU_SERIAL.setRxBufferSize(ECU_RX_RING_SIZE);
+#if USE_UART0
+  ECU_SERIAL.begin(ECU_BAUD);
+#else
+  ECU_SERIAL.begin(ECU_BAUD, SERIAL_8N1, ECU_RX_PIN, ECU_TX_PIN);
+#endif
+  ECU_SERIAL.setRxFIFOFull(ECU_RX_FIFO_FULL);
+  ECU_SERIAL.setRxTimeout(ECU_RX_TIMEOUT_SYM);
+  ECU_SERIAL.onReceive(ecuOnReceive, false);
+  while (ECU_SERIAL.available()) ECU_SERIAL.read();
+  rxState = WAIT_N;
+  rxCount = 0;
+  rxLen = 0;
+  ecuProto = setting_ecuProto;
+  rfState = RF_LEN_HI;
+  schedReset();
+  linkValid = false;
+  ecuSerialOpen = true;
+}
+
+// IN_CAN: stop polling and reading ECU_SERIAL; ecuSerialBegin() takes it back (and flushes).
+static void ecuSerialRelease() {
+  ECU_SERIAL.onReceive(nullptr);
+  schedReset();
+  ecuSerialOpen = false;
+}
+
+// ============================= Splash =============================
+static void showBasicSplash() {
+  tft.fillScreen(C_BG);
+  tft.setTextColor(TFT_WHITE, C_BG);
+  tft.setTextSize(2);
+  const char* txt = "@BROKENAGAIN_MINI";
+  int tw = tft.textWidth(txt);
+  tft.setCursor((SCREEN_W - tw)/2, (SCREEN_H/2) - 14);
+  tft.print(txt);
+
+  tft.setTextSize(1);
+  String v = String("esp_dash_") + FW_VERSION;
+  int tw2 = tft.textWidth(v);
+  tft.setCursor((SCREEN_W - tw2)/2, (SCREEN_H/2) + 14);
+  tft.print(v);
+}
+
+static void showSplashThenStartSerial() {
+  showBasicSplash();
+  uint32_t t0 = millis();
+  while (millis() - t0 < SPLASH_DELAY_MS) delay(10);
+
+  ecuSerialBegin();
+}
+
+// ============================= Decode =============================
+// AFR is the one runtime-formatted channel; the result is always AFR x100.
+static int32_t decodeAfrX100(const uint8_t* p, int offset, int len) {
+  if (setting_afrFmt == AFR_U16_x100) {
+    if (offset + 1 >= len) return 0;
+    return u16le(&p[offset]);
+  } else if (setting_afrFmt == AFR_U16_x10) {
+    if (offset + 1 >= len) return 0;
+    return (int32_t)u16le(&p[offset]) * 10;
+  } else {
+    if (offset >= len) return 0;
+    return (int32_t)p[offset] * 10;
+  }
+}
+
+template <uint8_t I>
+static inline int32_t decodeChannel(const uint8_t* p, int len) {
+  constexpr ChannelDesc d = CHANNELS[I];
+  if constexpr (d.type == CT_U8)  return p[d.offset];
+  if constexpr (d.type == CT_S8)  return (int8_t)p[d.offset];
+  if constexpr (d.type == CT_U16) return u16le(&p[d.offset]);
+  if constexpr (d.type == CT_S16) return (int16_t)u16le(&p[d.offset]);
+  if constexpr (d.type == CT_BIT) return (p[d.offset] & d.mask) ? 1 : 0;
+  if constexpr (d.type == CT_AFR) return decodeAfrX100(p, d.offset, len);
+  return 0;
+}
+
+template <uint8_t... I>
+static inline void decodeChannelsFast(const uint8_t* p, int len, int32_t* out, std::integer_sequence<uint8_t, I...>) {
+  ((out[I] = decodeChannel<I>(p, len)), ...);
+}
+
+// Short frames (older firmware) fall back to a bounds-checked loop; missing channels read 0.
+static void decodeAllChannels(const uint8_t* p, int len, int32_t* out) {
+  if (len >= CH_FRAME_LEN) {
+    decodeChannelsFast(p, len, out, std::make_integer_sequence<uint8_t, CH_COUNT>{});
+    return;
+  }
+  for (int i = 0; i < CH_COUNT; i++) {
+    const ChannelDesc& d = CHANNELS[i];
+    if (d.offset + chWidth(d.type) > len) { out[i] = 0; continue; }
+    switch (d.type) {
+      case CT_U8:  out[i] = p[d.offset]; break;
+      case CT_S8:  out[i] = (int8_t)p[d.offset]; break;
+      case CT_U16: out[i] = u16le(&p[d.offset]); break;
+      case CT_S16: out[i] = (int16_t)u16le(&p[d.offset]); break;
+      case CT_BIT: out[i] = (p[d.offset] & d.mask) ? 1 : 0; break;
+      case CT_AFR: out[i] = decodeAfrX100(p, d.offset, len); break;
+      default:     out[i] = 0; break;
+    }
+  }
+}
+
+// Inverse of decodeAllChannels(): lays raw values out as an 'n' payload of CH_FRAME_LEN bytes
+// (AFR in the current setting_afrFmt). Used by the replay and the decode benchmark.
+static void encodeAllChannels(const int32_t* raw, uint8_t* p) {
+  memset(p, 0, CH_FRAME_LEN);
+  for (int i = 0; i < CH_COUNT; i++) {
+    const ChannelDesc& d = CHANNELS[i];
+    int32_t v = raw[i];
+    uint8_t w = chWidth(d.type);
+    if (d.type == CT_BIT) { if (v) p[d.offset] |= d.mask; continue; }
+    if (d.type == CT_AFR) {
+      if (setting_afrFmt != AFR_U16_x100) v /= 10;
+      if (setting_afrFmt == AFR_U8_div10) w = 1;
+    }
+    for (uint8_t b = 0; b < w; b++) p[d.offset + b] = (uint8_t)(v >> (8 * b));
+  }
+}
+
+// ============================= Channel merge =============================
+// Every transport ends here: the channels in `mask` from `raw` go into the one snapshot.
+// A channel goes to whichever source last set it unless a higher-ranked EcuSource has it and
+// is still fresh (LINK_STALE_MS), so a CAN wideband keeps AFR while serial frames fill in the
+// rest. Timestamps never go backwards, whichever input task got the mutex first.
+// A frame that sets RPM is a primary frame: only those move lastUpdateMs and run the warning
+// engine, black box and log queue, so those keep the ECU's frame rate and the gauge's
+// extrapolation sees real RPM samples. Other merges (a wideband alone) are only published.
+// Input tasks take turns on ecuMergeMutex; readers stay lock-free on the seqlock.
+static void ecuMerge(uint8_t src, const int32_t* raw, ChMask mask, uint32_t frameMs) {
+  xSemaphoreTake(ecuMergeMutex, portMAX_DELAY);
+  const uint32_t ms = (int32_t)(frameMs - ecuMergeMs) > 0 ? frameMs : ecuMergeMs;
+  ecuMergeMs = ms;
+  ChMask taken = 0;
+  for (uint8_t s = src + 1; s < SRC_COUNT; s++) {
+    if (srcFresh(ecuRx, s, ms)) mask &= ~ecuRx.srcCh[s];   // outranked while that one is live
+  }
+  for (uint8_t i = 0; i < CH_COUNT; i++) {
+    if (!(mask & chBit(i))) continue;
+    ecuRx.raw[i] = raw[i];
+    taken |= chBit(i);
+  }
+  for (uint8_t s = 0; s < SRC_COUNT; s++) ecuRx.srcCh[s] &= ~taken;
+  ecuRx.srcCh[src] |= taken;
+  ecuRx.srcMs[src] = ms;
+
+  if (taken & chBit(CH_RPM)) {
+    ecuRx.lastUpdateMs = ms;
+    ecuRx.warn = warnEval(ecuRx, ecuFreshMask(ecuRx, ms));
+    warnMask.store(ecuRx.warn, std::memory_order_relaxed);
+    ecuPublish(ecuRx);
+#if USE_SD
+    bbPush(ecuRx);
+    logPushFrame(ecuRx);
+#endif
+  } else {
+    ecuPublish(ecuRx);
+  }
+  xSemaphoreGive(ecuMergeMutex);
+  linkValid = true;
+}
+
+// frameMs is the time the last byte of the frame was taken off the UART.
+static void decodePayload(const uint8_t* p, int len, uint32_t frameMs) {
+  if (len < 40) return;
+  PHASE_SCOPE(PH_DECODE);
+
+  int32_t raw[CH_COUNT];
+  decodeAllChannels(p, len, raw);
+  ecuMerge(SRC_SERIAL, raw, CH_ALL, frameMs);
+}
+
+// Feeds one bulk read through the 'n' framer. Header bytes step the state machine; payload
+// bytes are copied in one go, and a finished frame is decoded whole with a single timestamp.
+static void onRxBytesN(const uint8_t* b, size_t n, uint32_t now) {
+  size_t i = 0;
+  while (i < n) {
+    switch (rxState) {
+      case WAIT_N:    if (b[i++] == CMD_N) rxState = WAIT_TYPE; break;
+      case WAIT_TYPE: i++; rxState = WAIT_LEN; break;
+      case WAIT_LEN:
+        rxLen = b[i++];
+        rxCount = 0;
+        if (rxLen == 0 || rxLen > MAX_PAYLOAD) rxState = WAIT_N;
+        else rxState = READ_PAYLOAD;
+        break;
+      case READ_PAYLOAD: {
+        size_t take = min((size_t)(rxLen - rxCount), n - i);
+        memcpy(&payload[rxCount], &b[i], take);
+        rxCount += (int)take;
+        i += take;
+        if (rxCount >= rxLen) {
+          schedOnReply(now);
+          ecuFramesOk = ecuFramesOk + 1;
+          decodePayload(payload, rxLen, now);
+          rxState = WAIT_N;
+        }
+        break;
+      }
+    }
+  }
+}
+
+// Drop the pipeline and ignore input until the line goes quiet; pollSpeeduino() restarts it.
+static void rResync(uint32_t now) {
+  schedReset();
+  rfState = RF_DISCARD;
+  ecuLastByteMs = now;
+}
+
+static void rFrameDone(uint32_t now) {
+  const uint32_t calc = crc32(payload, rfLen);
+  const uint32_t got = ((uint32_t)rfCrc[0] << 24) | ((uint32_t)rfCrc[1] << 16) | ((uint32_t)rfCrc[2] << 8) | rfCrc[3];
+  if (calc != got) { ecuCrcErrors = ecuCrcErrors + 1; rResync(now); return; }
+
+  schedOnReply(now);
+  if (rfLen < 2 || payload[0] != R_RC_OK) { ecuBadFrames = ecuBadFrames + 1; rfState = RF_LEN_HI; return; }
+
+  ecuFramesOk = ecuFramesOk + 1;
+  decodePayload(payload + 1, rfLen - 1, now);
+  rfState = RF_LEN_HI;
+}
+
+// 'r' reply framer; same chunked approach as the 'n' one.
+static void onRxBytesR(const uint8_t* b, size_t n, uint32_t now) {
+  size_t i = 0;
+  while (i < n) {
+    switch (rfState) {
+      case RF_DISCARD: return;
+      case RF_LEN_HI:  rfLen = (uint16_t)b[i++] << 8; rfState = RF_LEN_LO; break;
+      case RF_LEN_LO:
+        rfLen |= b[i++];
+        rfCount = 0;
+        if (rfLen == 0 || rfLen > MAX_PAYLOAD) { ecuBadFrames = ecuBadFrames + 1; rResync(now); return; }
+        rfState = RF_PAYLOAD;
+        break;
+      case RF_PAYLOAD: {
+        size_t take = min((size_t)(rfLen - rfCount), n - i);
+        memcpy(&payload[rfCount], &b[i], take);
+        rfCount += (int)take;
+        i += take;
+        if (rfCount >= rfLen) { rfCount = 0; rfState = RF_CRC; }
+        break;
+      }
+      case RF_CRC:
+        rfCrc[rfCount++] = b[i++];
+        if (rfCount == 4) rFrameDone(now);
+        break;
     }
-    if (ctx->mbox) lv_obj_del_async(ctx->mbox);
-    // Release any stuck touch/press state (common after msgbox clicks)
-    lv_indev_t* indev = lv_indev_get_act();
-    if (indev) lv_indev_reset(indev, NULL);
-    free(ctx);
   }
-  lv_timer_del(t);
 }
 
-static void default_confirm_cb(lv_event_t* e) {
-  lv_obj_t* mbox = (lv_obj_t*)lv_event_get_user_data(e);
-  const char* txt = lv_msgbox_get_active_btn_text(mbox);
-  if (!txt) return;
+static void onRxBytes(const uint8_t* b, size_t n) {
+  rxBytes += n;
+  const uint32_t now = millis();
+  ecuLastByteMs = now;
+#if USE_SD
+  capPush(b, n, now);
+#endif
+  if (ecuProto == PROTO_R) onRxBytesR(b, n, now);
+  else                     onRxBytesN(b, n, now);
+}
 
-  bool apply = (strcmp(txt, "Yes") == 0);
+static void drainEcuSerial() {
+  static uint8_t chunk[ECU_RX_CHUNK];
+  int avail;
+  while ((avail = ECU_SERIAL.available()) > 0) {
+    size_t got = ECU_SERIAL.read(chunk, min((size_t)avail, sizeof(chunk)));
+    if (got == 0) break;
+    onRxBytes(chunk, got);
+  }
+}
 
-  DefaultActionCtx* ctx = (DefaultActionCtx*)malloc(sizeof(DefaultActionCtx));
-  if (!ctx) { if (mbox) lv_obj_del_async(mbox); return; }
-  ctx->mbox = mbox;
-  ctx->apply = apply;
+static void sendRequestR() {
+  uint8_t f[2 + 7 + 4];
+  f[0] = 0; f[1] = 7;
+  f[2] = CMD_R; f[3] = R_CAN_ID; f[4] = R_OCH_CMD;
+  f[5] = 0; f[6] = 0;                                    // offset
+  f[7] = (uint8_t)(R_REQ_LEN & 0xFF); f[8] = (uint8_t)(R_REQ_LEN >> 8);
+  const uint32_t c = crc32(&f[2], 7);
+  f[9] = (uint8_t)(c >> 24); f[10] = (uint8_t)(c >> 16); f[11] = (uint8_t)(c >> 8); f[12] = (uint8_t)c;
+  ECU_SERIAL.write(f, sizeof(f));
+}
 
-  lv_timer_t* t = lv_timer_create(default_action_timer, 1, ctx);
-  lv_timer_set_repeat_count(t, 1);
+static bool framerIdle() {
+  return (ecuProto == PROTO_R) ? (rfState == RF_LEN_HI) : (rxState == WAIT_N);
 }
-static void mbox_default_deleted_cb(lv_event_t* e) {
-  if (lv_event_get_code(e) != LV_EVENT_DELETE) return;
-  mbox_default = nullptr;
+
+// Drops a half-received frame and everything in flight. The next request goes out right away.
+static void framerReset(uint32_t now) {
+  if (ecuProto == PROTO_R) { rResync(now); return; }
+  schedReset();
+  rxState = WAIT_N;
+  rxCount = 0;
 }
 
-static void showDefaultConfirm() {
-  if (mbox_default) return;
-  static const char* btns[] = {"No", "Yes", ""};
+// Called every acqTask pass. A request goes out as soon as there is room in the pipeline
+// (1 for 'n', setting_pipeDepth for 'r'), no sooner than 1/setting_pollMaxHz after the last
+// one; with several in flight they are also spread over RTT / depth. Stuck states (no reply,
+// or a frame that stops mid-way) are timed out here instead of waiting for LINK_STALE_MS.
+static void pollSpeeduino() {
+  const uint32_t now = millis();
+  rttWindowRoll(now);
 
-  // Create on the current screen so it stays in the same LVGL context
-  mbox_default = lv_msgbox_create(lv_scr_act(), "Defaults", "Reset warning alarms to default values?", btns, false);
-  lv_obj_center(mbox_default);
-  lv_obj_add_event_cb(mbox_default, mbox_default_deleted_cb, LV_EVENT_DELETE, nullptr);
+  if (ecuProto == PROTO_R && rfState == RF_DISCARD) {
+    if (now - ecuLastByteMs < R_RESYNC_IDLE_MS) return;
+    rfState = RF_LEN_HI;
+  }
+  if (reqInflight && now - reqSentMs[reqSentTail] > reqTimeoutMs()) { framerReset(now); return; }
+  if (!framerIdle() && now - ecuLastByteMs > RX_BYTE_GAP_MS)       { framerReset(now); return; }
 
-  // Attach callback to btnmatrix and pass msgbox as user_data
-  lv_obj_t* btnm = lv_msgbox_get_btns(mbox_default);
-  if (btnm) {
-    lv_obj_add_event_cb(btnm, default_confirm_cb, LV_EVENT_VALUE_CHANGED, mbox_default);
+  const uint8_t depth = (ecuProto == PROTO_R) ? (uint8_t)clampi(setting_pipeDepth, 1, R_PIPE_MAX) : 1;
+  if (reqInflight >= depth) return;
+  if (ecuProto == PROTO_N && !framerIdle()) return;   // unsolicited frame still arriving
+
+  uint32_t gap = 1000u / (uint32_t)clampi(pollCapHz(), 1, 100);
+  if (reqInflight) gap = max(gap, rttAvgMs() / depth);
+  if (now - lastPoll < gap) return;
+
+  if (ecuProto == PROTO_R) sendRequestR();
+  else                     ECU_SERIAL.write(CMD_N);
+  schedOnSend(now);
+  lastPoll = now;
+}
+
+// ============================= Replay =============================
+#if USE_REPLAY
+// Feeds a recorded session back in place of ECU_SERIAL, paced by its own timestamps (x speed):
+//  - .cap raw captures (see capPush()) go through onRxBytes(), i.e. the real 'n' / 'r' framer
+//    and decoder, with the byte-gap and resync timeouts of pollSpeeduino() applied on the
+//    recorded clock. The AFR format and channel table are the current ones, so a decoder change
+//    can be rerun over an old session.
+//  - CSV logs: each row is turned back into raw values and an 'n' payload (encodeAllChannels)
+//    for decodePayload(). Columns are matched by name: logs from older builds replay with their
+//    missing channels at 0. Rows come at logging resolution, so an interval log replays at 10 Hz.
+// Either way the warning engine, black box, logging and UI see what a live link would produce.
+// /replay only posts a command; acqTask owns the file.
+static const size_t REPLAY_BUF = 2048;
+static const uint8_t REPLAY_MAX_COLS = CH_COUNT + 8;   // unknown extra columns are skipped
+static const uint8_t REPLAY_COL_SKIP = 0xFF;
+
+enum ReplayCmd : uint8_t { REPLAY_NONE = 0, REPLAY_START, REPLAY_STOP };
+static std::atomic<uint8_t> replayCmd{REPLAY_NONE};
+static char replayReqPath[32];                 // set before replayCmd is published
+static uint8_t replayReqSpeed = 1;
+static bool replayReqLoop = false;
+
+// acqTask writes, portal reads (replayActive is with the link state).
+static volatile uint32_t replayFrames = 0;
+static char replayName[32];
+
+struct ReplayState {
+  File f;
+  uint8_t buf[REPLAY_BUF];
+  size_t len, pos;
+  bool cap;                       // .cap (raw bytes) rather than CSV
+  uint8_t col[REPLAY_MAX_COLS];   // CSV column -> ChId; column 0 is ms
+  uint8_t cols;
+  uint8_t speed;
+  bool loop;
+  bool have;                      // next row / chunk read and waiting for its time
+  int32_t nextRaw[CH_COUNT];      // CSV
+  uint8_t chunk[ECU_RX_CHUNK];    // .cap
+  uint16_t chunkLen, chunkGapMs;
+  uint32_t nextMs, firstMs, t0;
+};
+static ReplayState rp;
+
+// Buffered read of exactly n bytes; false at end of file.
+static bool replayRead(void* dst, size_t n) {
+  uint8_t* d = (uint8_t*)dst;
+  while (n) {
+    if (rp.pos == rp.len) {
+      sdLock();
+      rp.len = rp.f.read(rp.buf, sizeof(rp.buf));
+      sdUnlock();
+      rp.pos = 0;
+      if (rp.len == 0) return false;
+    }
+    const size_t take = min(n, rp.len - rp.pos);
+    memcpy(d, rp.buf + rp.pos, take);
+    rp.pos += take;
+    d += take;
+    n -= take;
   }
+  return true;
 }
 
-static bool warnCheckFloat(WarnId id, float v) {
-  if (!warnCfg[id].enabled) return false;
-  return (v < warnCfg[id].minV) || (v > warnCfg[id].maxV);
+// Next line (without CR/LF) into out; false at end of file.
+static bool replayReadLine(char* out, size_t outSz) {
+  size_t n = 0;
+  char c;
+  while (replayRead(&c, 1)) {
+    if (c == '\n') { out[n] = 0; return true; }
+    if (c != '\r' && n + 1 < outSz) out[n++] = c;
+  }
+  out[n] = 0;
+  return n > 0;
 }
-static bool warnCheckInt(WarnId id, int v) {
-  if (!warnCfg[id].enabled) return false;
-  return ((float)v < warnCfg[id].minV) || ((float)v > warnCfg[id].maxV);
+
+// "-12.34" -> fixed point with dec decimals (extra digits cut, missing ones padded).
+static int32_t parseFixed(const char* s, uint8_t dec) {
+  const bool neg = *s == '-';
+  if (neg) s++;
+  int32_t v = 0;
+  while (*s >= '0' && *s <= '9') v = v * 10 + (*s++ - '0');
+  uint8_t d = 0;
+  if (*s == '.') {
+    for (s++; *s >= '0' && *s <= '9' && d < dec; s++, d++) v = v * 10 + (*s - '0');
+  }
+  for (; d < dec; d++) v *= 10;
+  return neg ? -v : v;
 }
 
-// ============================= SD logging =============================
-#if USE_SD
-static String makeLogFilename() {
-  char buf[32];
-  snprintf(buf, sizeof(buf), "/log_%05lu.csv", (unsigned long)setting_logIndex);
-  return String(buf);
+static bool replayParseHeader(char* line) {
+  rp.cols = 0;
+  for (char* s = line; s && rp.cols < REPLAY_MAX_COLS;) {
+    char* comma = strchr(s, ',');
+    if (comma) *comma = 0;
+    uint8_t id = REPLAY_COL_SKIP;
+    for (int i = 0; i < CH_COUNT; i++) if (strcmp(s, CHANNELS[i].name) == 0) { id = (uint8_t)i; break; }
+    if (rp.cols == 0 && strcmp(s, "ms") != 0) return false;   // not one of our CSV logs
+    rp.col[rp.cols++] = id;
+    s = comma ? comma + 1 : nullptr;
+  }
+  return rp.cols > 1;
 }
 
-static void stopRecording() {
-  if (logFile) { logFile.flush(); logFile.close(); }
-  recording = false;
-  setRecButtonActive(false);
+static bool replayParseRow(char* line) {
+  if (line[0] < '0' || line[0] > '9') return false;
+  memset(rp.nextRaw, 0, sizeof(rp.nextRaw));
+  char* s = line;
+  for (uint8_t c = 0; c < rp.cols && s; c++) {
+    char* comma = strchr(s, ',');
+    if (comma) *comma = 0;
+    const uint8_t id = rp.col[c];
+    if (c == 0) {
+      rp.nextMs = strtoul(s, nullptr, 10);
+    } else if (id != REPLAY_COL_SKIP) {
+      const ChannelDesc& d = CHANNELS[id];
+      rp.nextRaw[id] = (parseFixed(s, d.dec) - d.bias) / d.mul;
+    }
+    s = comma ? comma + 1 : nullptr;
+  }
+  return true;
 }
 
-static const char* startRecording() {
-  if (!setting_logEnabled) return "Logging disabled";
-  if (!sdOk) return "SD card not detected";
-  if (recording) return "Already recording";
-  if (portalBusy) return "Portal busy";
+static void replayNext() {
+  rp.have = false;
+  if (rp.cap) {
+    uint8_t h[CAP_REC_HDR];
+    if (!replayRead(h, sizeof(h))) return;
+    rp.chunkGapMs = u16le(h);
+    rp.chunkLen = u16le(h + 2);
+    if (rp.chunkLen == 0 || rp.chunkLen > sizeof(rp.chunk) || !replayRead(rp.chunk, rp.chunkLen)) return;
+    rp.nextMs += rp.chunkGapMs;
+    rp.have = true;
+    return;
+  }
+  char line[CSV_LINE_MAX];
+  while (replayReadLine(line, sizeof(line))) {
+    if (replayParseRow(line)) { rp.have = true; return; }
+  }
+}
 
-  String fn = makeLogFilename();
-  logFile = SD.open(fn.c_str(), FILE_WRITE);
-  if (!logFile) return "Failed to open log file";
+// Back to the start of the file; the replay clock restarts now. A .cap also resets the
+// framer to the protocol it was recorded with (ecuSerialBegin() restores it afterwards).
+static bool replayRewind() {
+  sdLock();
+  const bool ok = rp.f.seek(0);
+  sdUnlock();
+  rp.len = rp.pos = 0;
+  if (!ok) return false;
+  if (rp.cap) {
+    CapHeader h;
+    if (!replayRead(&h, sizeof(h)) || memcmp(h.magic, "EDCP", 4) != 0 || h.version != CAP_VERSION) return false;
+    ecuProto = h.proto == PROTO_R ? PROTO_R : PROTO_N;
+    rxState = WAIT_N;
+    rxCount = 0;
+    rfState = RF_LEN_HI;
+    schedReset();
+    rp.nextMs = 0;
+  } else {
+    char line[CSV_LINE_MAX];
+    if (!replayReadLine(line, sizeof(line)) || !replayParseHeader(line)) return false;
+  }
+  replayNext();
+  rp.firstMs = rp.cap ? 0 : rp.nextMs;
+  rp.t0 = millis();
+  return rp.have;
+}
 
-  logFile.println("ms,rpm,iatC,cltC,vbat,afr,tps,advance,warmup,launch");
-  recording = true;
-  setRecButtonActive(true);
+static void replayStop() {
+  sdLock();
+  if (rp.f) rp.f.close();
+  sdUnlock();
+  replayActive = false;
+  ecuSerialOpen = false;   // reopen: drops whatever the ECU sent meanwhile, restarts polling
+}
 
-  setting_logIndex++;
-  saveSettings();
-  lastLogMs = 0;
-  return nullptr;
+static bool replayStart(const char* path, uint8_t speed, bool loop) {
+  if (replayActive) replayStop();
+  sdLock();
+  rp.f = SD.open(path, FILE_READ);
+  sdUnlock();
+  if (!rp.f) return false;
+  rp.cap = endsWithExt(path, "cap");
+  if (!replayRewind()) { replayStop(); return false; }
+  rp.speed = (uint8_t)clampi(speed, 1, 16);
+  rp.loop = loop;
+  snprintf(replayName, sizeof(replayName), "%s", path);
+  replayFrames = 0;
+  replayActive = true;
+  DBG_PRINTF("[REPLAY] %s x%u\n", path, (unsigned)rp.speed);
+  return true;
 }
 
-static void logIfRecording() {
-  if (!recording || !sdOk || !logFile) return;
-  if (portalBusy) return;
-  if (millis() - lastLogMs < LOG_INTERVAL_MS) return;
-  lastLogMs = millis();
-
-  logFile.print(millis()); logFile.print(",");
-  logFile.print(ecu.rpm);  logFile.print(",");
-  logFile.print(ecu.iatC); logFile.print(",");
-  logFile.print(ecu.cltC); logFile.print(",");
-  logFile.print(ecu.vbat, 2); logFile.print(",");
-  logFile.print(ecu.afr, 2);  logFile.print(",");
-  logFile.print(ecu.tps);     logFile.print(",");
-  logFile.print(ecu.advance); logFile.print(",");
-  logFile.print((int)ecu.warmup); logFile.print(",");
-  logFile.println((int)ecu.launch);
+// acqTask, every pass while replaying: feeds every row / chunk that is due by now.
+static void replayStep() {
+  const uint32_t now = millis();
+  uint8_t p[CH_FRAME_LEN];
+  while (rp.have) {
+    const int32_t at = (int32_t)(rp.nextMs - rp.firstMs);   // rows that go back in time are due at once
+    if (at > 0 && (uint64_t)(now - rp.t0) * rp.speed < (uint32_t)at) break;
+    if (rp.cap) {
+      // What pollSpeeduino() would have done during the recorded gap before this read.
+      if (ecuProto == PROTO_R && rfState == RF_DISCARD && rp.chunkGapMs >= R_RESYNC_IDLE_MS) rfState = RF_LEN_HI;
+      if (!framerIdle() && rp.chunkGapMs > RX_BYTE_GAP_MS) framerReset(now);
+      onRxBytes(rp.chunk, rp.chunkLen);
+    } else {
+      encodeAllChannels(rp.nextRaw, p);
+      ecuFramesOk = ecuFramesOk + 1;
+      decodePayload(p, CH_FRAME_LEN, now);
+    }
+    replayFrames = replayFrames + 1;
+    replayNext();
+  }
+  if (rp.have) return;
+  if (!rp.loop || !replayRewind()) { DBG_PRINTF("[REPLAY] done\n"); replayStop(); }
+}
 
-  static uint32_t lastFlush = 0;
-  if (millis() - lastFlush > LOG_FLUSH_MS) { logFile.flush(); lastFlush = millis(); }
+// acqTask: picks up /replay commands. Returns true while a replay owns the decoder.
+static bool replayPoll() {
+  const uint8_t cmd = replayCmd.exchange(REPLAY_NONE, std::memory_order_acquire);
+  if (cmd == REPLAY_STOP && replayActive) replayStop();
+  if (cmd == REPLAY_START && !replayStart(replayReqPath, replayReqSpeed, replayReqLoop))
+    DBG_PRINTF("[REPLAY] cannot replay %s\n", replayReqPath);
+  if (replayActive) replayStep();
+  return replayActive;
 }
 #endif
 
-// ============================= Splash =============================
-static void showBasicSplash() {
-  tft.fillScreen(C_BG);
-  tft.setTextColor(TFT_WHITE, C_BG);
-  tft.setTextSize(2);
-  const char* txt = "@BROKENAGAIN_MINI";
-  int tw = tft.textWidth(txt);
-  tft.setCursor((SCREEN_W - tw)/2, (SCREEN_H/2) - 14);
-  tft.print(txt);
+// ============================= Acquisition task (core 0) =============================
+// Drains/polls the ECU independently of LVGL frame time and of the portal.
+// Sleeps on a task notification from ecuOnReceive(), waking at least once per ms for polling.
+static void acqTask(void*) {
+  for (;;) {
+#if USE_REPLAY
+    if (replayPoll()) { ulTaskNotifyTake(pdTRUE, 1); continue; }
+#endif
+#if USE_CAN
+    if (setting_ecuInput == IN_CAN) {   // canTask feeds the snapshot on its own
+      if (ecuSerialOpen) ecuSerialRelease();
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+      continue;
+    }
+#endif
+    // (Re)open on start and when the portal switches protocol.
+    if (!ecuSerialOpen || ecuProto != setting_ecuProto) ecuSerialBegin();
 
-  tft.setTextSize(1);
-  String v = String("esp_dash_") + FW_VERSION;
-  int tw2 = tft.textWidth(v);
-  tft.setCursor((SCREEN_W - tw2)/2, (SCREEN_H/2) + 14);
-  tft.print(v);
-}
+    {
+      PHASE_SCOPE(PH_DRAIN);
+      drainEcuSerial();
+    }
 
-static void showSplashThenStartSerial() {
-  showBasicSplash();
-  uint32_t t0 = millis();
-  while (millis() - t0 < SPLASH_DELAY_MS) delay(10);
+    pollSpeeduino();
 
-#if USE_UART0
-  ECU_SERIAL.begin(ECU_BAUD);
-#else
-  ECU_SERIAL.begin(ECU_BAUD, SERIAL_8N1, ECU_RX_PIN, ECU_TX_PIN);
-#endif
-  while (ECU_SERIAL.available()) ECU_SERIAL.read();
-  rxState = WAIT_N;
-  rxCount = 0;
-  rxLen = 0;
-  linkValid = false;
-  lastRxMs = 0;
+    ulTaskNotifyTake(pdTRUE, 1);
+  }
 }
 
-// ============================= Decode =============================
-static float decodeAfr(const uint8_t* p, int len) {
-  if (setting_afrFmt == AFR_U16_x100) {
-    if (AFR_INDEX + 1 >= len) return 0;
-    uint16_t v = u16le(&p[AFR_INDEX]);
-    return (float)v / 100.0f;
-  } else if (setting_afrFmt == AFR_U16_x10) {
-    if (AFR_INDEX + 1 >= len) return 0;
-    uint16_t v = u16le(&p[AFR_INDEX]);
-    return (float)v / 10.0f;
-  } else {
-    if (AFR_INDEX >= len) return 0;
-    return (float)p[AFR_INDEX] / 10.0f;
+// ============================= CAN transport (TWAI) =============================
+#if USE_CAN
+// canTask owns the TWAI driver (installed only while an ECU input setting needs it) and
+// turns frames into channels for ecuMerge(), SRC_CAN:
+//  - ECU broadcast (IN_SERIAL_CAN / IN_CAN): an ECU-side CAN output or bridge sends the 'n'
+//    payload as CAN_BCAST_FRAMES frames of 8 bytes, slice k at CAN_BCAST_BASE_ID + k. The
+//    slices go through decodeAllChannels(), so AFR format and channel table are the serial ones.
+//  - Wideband (setting_canWbo): AEM X-Series UEGO lambda -> CH_AFR.
+// Nothing is requested, so there is no round trip: whatever has arrived is merged at most
+// every CAN_MERGE_MS, and only the channels of the slices received since the last merge.
+// The node ACKs (normal mode) but never transmits; on bus-off it recovers by itself.
+static const uint8_t  CAN_BCAST_FRAMES = (CH_FRAME_LEN + 7) / 8;
+static const uint32_t CAN_MERGE_MS = 5;
+static const uint32_t CAN_IDLE_WAIT_MS = 100;    // receive timeout with nothing pending
+static const uint32_t CAN_STATUS_MS = 100;       // bus state check
+static const uint32_t CAN_RETRY_MS = 1000;       // driver install retry
+
+// Channels carried by each broadcast slice (none may straddle two slices).
+static constexpr ChMask canSliceMask(uint8_t k) {
+  ChMask m = 0;
+  for (int i = 0; i < CH_COUNT; i++) {
+    const int first = CHANNELS[i].offset / 8;
+    const int last = (CHANNELS[i].offset + chWidth(CHANNELS[i].type) - 1) / 8;
+    if (first == k && last == k) m |= chBit(i);
   }
+  return m;
+}
+static constexpr bool canSlicesOk() {
+  ChMask all = 0;
+  for (uint8_t k = 0; k < CAN_BCAST_FRAMES; k++) all |= canSliceMask(k);
+  return all == CH_ALL;
+}
+static_assert(canSlicesOk(), "every channel must fit in one 8-byte CAN broadcast slice");
+static_assert(CAN_BCAST_FRAMES <= 8, "canSlices is a byte");
+
+// canTask writes, portal reads.
+static volatile bool canUp = false;
+static volatile uint32_t canFrames = 0;    // frames used
+static volatile uint32_t canMerges = 0;
+static volatile uint32_t canMissed = 0;    // TWAI RX queue overruns
+static volatile uint32_t canBusOffs = 0;
+
+struct CanState {
+  uint8_t payload[CAN_BCAST_FRAMES * 8];
+  uint8_t slices;            // broadcast slices received since the last merge, bit per slice
+  bool wbo;                  // wideband value waiting
+  int32_t afrX100;
+  uint32_t wboMs;            // last wideband frame
+};
+static CanState cs;
+
+static bool canBegin() {
+  twai_general_config_t g = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)CAN_TX_PIN, (gpio_num_t)CAN_RX_PIN, TWAI_MODE_NORMAL);
+  g.rx_queue_len = CAN_RX_QUEUE_LEN;
+  g.tx_queue_len = 0;
+  const twai_timing_config_t t = TWAI_TIMING_CONFIG_500KBITS();
+  const twai_filter_config_t flt = TWAI_FILTER_CONFIG_ACCEPT_ALL();   // IDs are sorted in canOnFrame()
+  if (twai_driver_install(&g, &t, &flt) != ESP_OK) return false;
+  if (twai_start() != ESP_OK) { twai_driver_uninstall(); return false; }
+  memset(&cs, 0, sizeof(cs));
+  canUp = true;
+  DBG_PRINTF("[CAN] up, 500 kbit/s\n");
+  return true;
 }
 
-static void decodePayload(const uint8_t* p, int len) {
-  if (len < 40) return;
-
-  ecu.iatC = (int)p[IDX_IAT] - TEMP_OFFSET;
-  ecu.cltC = (int)p[IDX_CLT] - TEMP_OFFSET;
-  ecu.rpm  = (int)u16le(&p[IDX_RPM_L]);
-  ecu.vbat = ((float)p[IDX_VBAT10]) / 10.0f;
-  ecu.afr  = decodeAfr(p, len);
-  ecu.advance = (int)p[IDX_ADVANCE];
-  ecu.tps = ((int)p[IDX_TPS] + 1) / 2;
+static void canEnd() {
+  if (!canUp) return;
+  twai_stop();
+  twai_driver_uninstall();
+  canUp = false;
+}
 
-  uint8_t eng = p[IDX_ENGINE];
-  ecu.warmup = bitSetU8(eng, 3);
+static void canOnFrame(const twai_message_t& m, uint32_t now) {
+  if (m.rtr) return;
+  if (!m.extd && setting_ecuInput != IN_SERIAL && m.identifier >= CAN_BCAST_BASE_ID &&
+      m.identifier < CAN_BCAST_BASE_ID + CAN_BCAST_FRAMES) {
+    const uint8_t k = (uint8_t)(m.identifier - CAN_BCAST_BASE_ID);
+    memcpy(cs.payload + 8 * k, m.data, min((uint8_t)8, m.data_length_code));
+    cs.slices |= (uint8_t)(1u << k);
+    canFrames = canFrames + 1;
+  } else if (m.extd && setting_canWbo && m.identifier == CAN_WBO_ID && m.data_length_code >= 2) {
+    const uint32_t lambda = ((uint32_t)m.data[0] << 8) | m.data[1];   // x10000
+    if (lambda == 0) return;   // sensor warming up / no reading
+    cs.afrX100 = (int32_t)((lambda * 147 + 500) / 1000);             // stoich 14.7
+    cs.wbo = true;
+    cs.wboMs = now;
+    canFrames = canFrames + 1;
+  }
+}
 
-  uint8_t sp = p[IDX_SPARKBF];
-  ecu.launch = bitSetU8(sp, 0) || bitSetU8(sp, 1);
+static void canMerge(uint32_t now) {
+  int32_t raw[CH_COUNT] = {};
+  ChMask mask = 0;
+  if (cs.slices) {
+    decodeAllChannels(cs.payload, sizeof(cs.payload), raw);
+    for (uint8_t k = 0; k < CAN_BCAST_FRAMES; k++) if (cs.slices & (1u << k)) mask |= canSliceMask(k);
+  }
+  if (setting_canWbo && now - cs.wboMs <= LINK_STALE_MS) {
+    mask &= ~chBit(CH_AFR);   // the wideband's AFR, not the ECU's copy
+    if (cs.wbo) { raw[CH_AFR] = cs.afrX100; mask |= chBit(CH_AFR); }
+  }
+  cs.slices = 0;
+  cs.wbo = false;
+  if (!mask) return;
+  ecuMerge(SRC_CAN, raw, mask, now);
+  canMerges = canMerges + 1;
+}
 
-  ecu.lastUpdateMs = millis();
-  linkValid = true;
+static void canCheckBus() {
+  twai_status_info_t st;
+  if (twai_get_status_info(&st) != ESP_OK) return;
+  canMissed = st.rx_missed_count;
+  if (st.state == TWAI_STATE_BUS_OFF) {
+    canBusOffs = canBusOffs + 1;
+    twai_initiate_recovery();
+  } else if (st.state == TWAI_STATE_STOPPED) {
+    twai_start();   // recovery finished
+  }
 }
 
-static void onRxByte(uint8_t b) {
-  rxBytes++;
-  lastRxMs = millis();
+static void canTask(void*) {
+  uint32_t lastMerge = 0, lastStatus = 0;
+  for (;;) {
+    if (setting_ecuInput == IN_SERIAL && !setting_canWbo) { canEnd(); vTaskDelay(pdMS_TO_TICKS(200)); continue; }
+    if (!canUp && !canBegin()) { vTaskDelay(pdMS_TO_TICKS(CAN_RETRY_MS)); continue; }
 
-  switch (rxState) {
-    case WAIT_N:    if (b == CMD_N) rxState = WAIT_TYPE; break;
-    case WAIT_TYPE: rxState = WAIT_LEN; break;
-    case WAIT_LEN:
-      rxLen = b;
-      rxCount = 0;
-      if (rxLen == 0 || rxLen > MAX_PAYLOAD) rxState = WAIT_N;
-      else rxState = READ_PAYLOAD;
-      break;
-    case READ_PAYLOAD:
-      payload[rxCount++] = b;
-      if (rxCount >= rxLen) { decodePayload(payload, rxLen); rxState = WAIT_N; }
-      break;
+    uint32_t now = millis();
+    if (now - lastStatus >= CAN_STATUS_MS) { canCheckBus(); lastStatus = now; }
+
+    const bool pending = cs.slices || cs.wbo;
+    const uint32_t since = now - lastMerge;
+    TickType_t wait = pdMS_TO_TICKS(pending ? (since < CAN_MERGE_MS ? CAN_MERGE_MS - since : 0) : CAN_IDLE_WAIT_MS);
+    twai_message_t m;
+    while (twai_receive(&m, wait) == ESP_OK) {
+      canOnFrame(m, millis());
+      wait = 0;
+    }
+
+    now = millis();
+#if USE_REPLAY
+    if (replayActive) { cs.slices = 0; cs.wbo = false; continue; }   // the log owns the snapshot
+#endif
+    if ((cs.slices || cs.wbo) && now - lastMerge >= CAN_MERGE_MS) {
+      PHASE_SCOPE(PH_CAN);
+      canMerge(now);
+      lastMerge = now;
+    }
   }
 }
-
-static void pollSpeeduino() { if (rxState == WAIT_N) ECU_SERIAL.write(CMD_N); }
+#endif // USE_CAN
 
 // ============================= UI: tiles =============================
-static void style_tile_container(lv_obj_t* cont, bool warn=false) {
-  lv_obj_set_style_radius(cont, 10, 0);
-  lv_obj_set_style_bg_color(cont, warn ? lvcol(C_RED) : lvcol(C_PANEL), 0);
-  lv_obj_set_style_border_color(cont, lvcol(C_OUTLINE), 0);
-  lv_obj_set_style_border_width(cont, 2, 0);
-  lv_obj_set_style_pad_all(cont, 8, 0);
-  lv_obj_clear_flag(cont, LV_OBJ_FLAG_SCROLLABLE);
+// All tile styling lives in shared lv_style_t objects set up once. The warn look is an overlay
+// added on top of the normal styles and removed again, and only on a state transition, so a
+// plain value update touches just the value label and the bar.
+enum TileState : uint8_t { TS_NORMAL = 0, TS_WARN };
+
+static lv_style_t st_tile_cont, st_tile_cont_warn;
+static lv_style_t st_tile_txt_value, st_tile_txt_muted, st_tile_txt_warn;
+static lv_style_t st_tile_bar_main, st_tile_bar_warn;
+
+static void tile_styles_init() {
+  static bool done = false;
+  if (done) return;
+  done = true;
+
+  lv_style_init(&st_tile_cont);
+  lv_style_set_radius(&st_tile_cont, 10);
+  lv_style_set_bg_color(&st_tile_cont, lvcol(C_PANEL));
+  lv_style_set_border_color(&st_tile_cont, lvcol(C_OUTLINE));
+  lv_style_set_border_width(&st_tile_cont, 2);
+  lv_style_set_pad_all(&st_tile_cont, 8);
+
+  lv_style_init(&st_tile_cont_warn);
+  lv_style_set_bg_color(&st_tile_cont_warn, lvcol(C_RED));
+
+  lv_style_init(&st_tile_txt_value);
+  lv_style_set_text_color(&st_tile_txt_value, lvcol(C_TEXT));
+  lv_style_init(&st_tile_txt_muted);
+  lv_style_set_text_color(&st_tile_txt_muted, lvcol(C_MUTED));
+  lv_style_init(&st_tile_txt_warn);
+  lv_style_set_text_color(&st_tile_txt_warn, lv_color_black());
+
+  lv_style_init(&st_tile_bar_main);
+  lv_style_set_bg_color(&st_tile_bar_main, lvcol(C_BLUEG));
+  lv_style_init(&st_tile_bar_warn);
+  lv_style_set_bg_color(&st_tile_bar_warn, lvcol(C_RED));
 }
 
-static TileUI make_tile(lv_obj_t* parent, int x, int y, const char* name, const char* unit, uint16_t bar565) {
-  TileUI t{};
-  t.normalBar565 = bar565;
-  t.name = name;
-  t.unit = unit;
+struct TileSlot { int16_t x, y; };
+
+// Geometry of one dash view; RING_LAYOUT / BAR_LAYOUT below.
+struct ViewLayout {
+  int16_t tileW, tileH, barW;
+  const lv_font_t* nameFont;    // name + unit
+  const lv_font_t* valueFont;
+  TileSlot tiles[TILE_COUNT];   // tiles_all order
+};
+
+// Builds the tile in place: t.st_ind is referenced by LVGL, so t must not be a temporary.
+static void make_tile(TileUI& t, lv_obj_t* parent, const ViewLayout& L, const TileSlot& pos, const TileDef& def) {
+  tile_styles_init();
+  t = TileUI{};
+  t.normalBar565 = def.bar565;
+  t.name = def.name;
+  t.unit = def.unit;
+  t.state = TS_NORMAL;
 
   t.cont = lv_obj_create(parent);
-  lv_obj_set_pos(t.cont, x, y);
-  lv_obj_set_size(t.cont, 120, 70);
-  style_tile_container(t.cont, false);
+  lv_obj_set_pos(t.cont, pos.x, pos.y);
+  lv_obj_set_size(t.cont, L.tileW, L.tileH);
+  lv_obj_add_style(t.cont, &st_tile_cont, 0);
+  lv_obj_clear_flag(t.cont, LV_OBJ_FLAG_SCROLLABLE);
 
   t.lbl_name = lv_label_create(t.cont);
-  lv_label_set_text(t.lbl_name, name);
-  lv_obj_set_style_text_color(t.lbl_name, lvcol(C_MUTED), 0);
-  lv_obj_set_style_text_font(t.lbl_name, &lv_font_montserrat_12, 0);
+  lv_label_set_text(t.lbl_name, def.name);
+  lv_obj_add_style(t.lbl_name, &st_tile_txt_muted, 0);
+  lv_obj_set_style_text_font(t.lbl_name, L.nameFont, 0);
   lv_obj_align(t.lbl_name, LV_ALIGN_TOP_LEFT, 2, -2);
 
   t.lbl_unit = lv_label_create(t.cont);
-  lv_label_set_text(t.lbl_unit, unit);
-  lv_obj_set_style_text_color(t.lbl_unit, lvcol(C_MUTED), 0);
-  lv_obj_set_style_text_font(t.lbl_unit, &lv_font_montserrat_12, 0);
+  lv_label_set_text(t.lbl_unit, def.unit);
+  lv_obj_add_style(t.lbl_unit, &st_tile_txt_muted, 0);
+  lv_obj_set_style_text_font(t.lbl_unit, L.nameFont, 0);
   lv_obj_align(t.lbl_unit, LV_ALIGN_LEFT_MID, 2, 0);
 
   t.lbl_value = lv_label_create(t.cont);
   lv_label_set_text(t.lbl_value, "---");
-  lv_obj_set_style_text_color(t.lbl_value, lvcol(C_TEXT), 0);
-  lv_obj_set_style_text_font(t.lbl_value, &lv_font_montserrat_22, 0);
+  lv_obj_add_style(t.lbl_value, &st_tile_txt_value, 0);
+  lv_obj_set_style_text_font(t.lbl_value, L.valueFont, 0);
   lv_obj_align(t.lbl_value, LV_ALIGN_TOP_RIGHT, 2, 14);
 
   t.bar = lv_bar_create(t.cont);
-  lv_obj_set_size(t.bar, 100, 10);
+  lv_obj_set_size(t.bar, L.barW, 10);
   lv_obj_align(t.bar, LV_ALIGN_BOTTOM_MID, 0, -2);
   lv_bar_set_range(t.bar, 0, 1000);
   lv_bar_set_value(t.bar, 0, LV_ANIM_OFF);
-  lv_obj_set_style_bg_color(t.bar, lvcol(C_BLUEG), LV_PART_MAIN);
-  lv_obj_set_style_bg_color(t.bar, lvcol(bar565), LV_PART_INDICATOR);
-
-  return t;
+  lv_obj_add_style(t.bar, &st_tile_bar_main, LV_PART_MAIN);
+  lv_style_init(&t.st_ind);
+  lv_style_set_bg_color(&t.st_ind, lvcol(def.bar565));
+  lv_obj_add_style(t.bar, &t.st_ind, LV_PART_INDICATOR);
 }
 
-static void set_tile_value(TileUI& t, const char* value, int bar_0_1000, bool warn=false, bool on=false) {
-  style_tile_container(t.cont, warn);
-  lv_label_set_text(t.lbl_value, value);
-
-  if (warn) {
-    lv_obj_set_style_text_color(t.lbl_value, lv_color_black(), 0);
-    lv_obj_set_style_text_color(t.lbl_unit, lv_color_black(), 0);
-    lv_obj_set_style_text_color(t.lbl_name, lv_color_black(), 0);
-    lv_obj_set_style_bg_color(t.bar, lvcol(C_RED), LV_PART_MAIN);
-    lv_obj_set_style_bg_color(t.bar, lvcol(C_RED), LV_PART_INDICATOR);
+static void set_tile_state(TileUI& t, uint8_t state) {
+  if (t.state == state) return;
+  t.state = state;
+  if (state == TS_WARN) {
+    lv_obj_add_style(t.cont, &st_tile_cont_warn, 0);
+    lv_obj_add_style(t.lbl_value, &st_tile_txt_warn, 0);
+    lv_obj_add_style(t.lbl_unit, &st_tile_txt_warn, 0);
+    lv_obj_add_style(t.lbl_name, &st_tile_txt_warn, 0);
+    lv_obj_add_style(t.bar, &st_tile_bar_warn, LV_PART_MAIN);
+    lv_obj_add_style(t.bar, &st_tile_bar_warn, LV_PART_INDICATOR);
   } else {
-    lv_obj_set_style_text_color(t.lbl_value, lvcol(C_TEXT), 0);
-    lv_obj_set_style_text_color(t.lbl_unit, lvcol(C_MUTED), 0);
-    lv_obj_set_style_text_color(t.lbl_name, lvcol(C_MUTED), 0);
-    lv_obj_set_style_bg_color(t.bar, lvcol(C_BLUEG), LV_PART_MAIN);
-    lv_obj_set_style_bg_color(t.bar, lvcol(t.normalBar565), LV_PART_INDICATOR);
+    lv_obj_remove_style(t.cont, &st_tile_cont_warn, 0);
+    lv_obj_remove_style(t.lbl_value, &st_tile_txt_warn, 0);
+    lv_obj_remove_style(t.lbl_unit, &st_tile_txt_warn, 0);
+    lv_obj_remove_style(t.lbl_name, &st_tile_txt_warn, 0);
+    lv_obj_remove_style(t.bar, &st_tile_bar_warn, LV_PART_MAIN);
+    lv_obj_remove_style(t.bar, &st_tile_bar_warn, LV_PART_INDICATOR);
   }
+}
 
-  lv_bar_set_value(t.bar, bar_0_1000, LV_ANIM_OFF);
-  if (on) lv_bar_set_value(t.bar, 1000, LV_ANIM_OFF);
+static void set_tile_value(TileUI& t, const char* value, int bar_0_1000, bool warn=false, bool on=false) {
+  set_tile_state(t, warn ? TS_WARN : TS_NORMAL);
+  lv_label_set_text(t.lbl_value, value);
+  lv_bar_set_value(t.bar, on ? 1000 : bar_0_1000, LV_ANIM_OFF);
 }
 
 static void set_tile_blank(TileUI& t) {
-  style_tile_container(t.cont, false);
+  set_tile_state(t, TS_NORMAL);
   lv_label_set_text(t.lbl_value, "---");
   lv_bar_set_value(t.bar, 0, LV_ANIM_OFF);
 }
 
+// Draws def's channel from ecu into t: value text, bar, warn look.
+static void tile_show(TileUI& t, const TileDef& def, const EcuData& ecu) {
+  const int32_t fx = chFixed(ecu, def.ch);
+  if (def.onOff) {
+    set_tile_value(t, fx ? "ACTIVE" : "----", 0, false, fx != 0);
+    return;
+  }
+  const float v = chValue(ecu, def.ch);
+  const bool warn = (ecu.warn & warnBitsFor(def.ch)) != 0;
+  char buf[16];
+  if (def.dec == 0) snprintf(buf, sizeof(buf), "%d", (int)lroundf(v));
+  else              snprintf(buf, sizeof(buf), "%.*f", def.dec, v);
+  int bar = (int)(clampf((v - def.barMin) / (def.barMax - def.barMin), 0, 1) * 1000);
+  set_tile_value(t, buf, bar, warn);
+}
+
 // ============================= UI layout switching =============================
-static void layout_tiles_ring();
-static void layout_tiles_bar();
+// Both views are constexpr tables plus a gauge builder, and build_view<> stamps one out into
+// cont_view. Only the active view exists: a switch deletes its objects and builds the other,
+// so the meter and the bar never sit in the LVGL heap together and refresh only walks one tree.
+static const int16_t RING_TILE_W = 105, RING_TILE_H = 70, RING_GAP_Y = 6;
+static const int16_t RING_L_X = 4, RING_R_X = SCREEN_W - 8 - RING_TILE_W;
+static constexpr int16_t ringTileY(int row) { return STATUS_H + 6 + (RING_TILE_H + RING_GAP_Y) * row; }
+
+static constexpr ViewLayout RING_LAYOUT = {
+  RING_TILE_W, RING_TILE_H, 100, &lv_font_montserrat_12, &lv_font_montserrat_22,
+  { { RING_L_X, ringTileY(0) },   // AFR
+    { RING_L_X, ringTileY(1) },   // VBAT
+    { RING_L_X, ringTileY(2) },   // IAT
+    { RING_L_X, ringTileY(3) },   // CLT
+    { RING_R_X, ringTileY(0) },   // TPS
+    { RING_R_X, ringTileY(1) },   // ADV
+    { RING_R_X, ringTileY(2) },   // WARMUP
+    { RING_R_X, ringTileY(3) } }, // LAUNCH
+};
 
-static void apply_view_layout() {
-  if (setting_viewMode == VIEW_RING) {
-    for (int i=0;i<8;i++){
-      lv_obj_set_size(tiles_all[i]->cont, 105, 70);
-      lv_obj_set_width(tiles_all[i]->bar, 100);
-    }
-    layout_tiles_ring();
-  } else {
-    layout_tiles_bar();
+static const int16_t BAR_TILE_W = 114, BAR_TILE_H = 70, BAR_GAP_X = 6, BAR_GAP_Y = 8;
+static constexpr int16_t barTileX(int col) { return (SCREEN_W - (4 * BAR_TILE_W + 3 * BAR_GAP_X)) / 2 + (BAR_TILE_W + BAR_GAP_X) * col; }
+static constexpr int16_t barTileY(int row) { return STATUS_H + 110 + (BAR_TILE_H + BAR_GAP_Y) * row; }
+
+static constexpr ViewLayout BAR_LAYOUT = {
+  BAR_TILE_W, BAR_TILE_H, BAR_TILE_W - 20, &lv_font_montserrat_12, &lv_font_montserrat_22,
+  { { barTileX(0), barTileY(0) },   // AFR
+    { barTileX(1), barTileY(0) },   // VBAT
+    { barTileX(0), barTileY(1) },   // IAT
+    { barTileX(1), barTileY(1) },   // CLT
+    { barTileX(2), barTileY(0) },   // TPS
+    { barTileX(3), barTileY(0) },   // ADV
+    { barTileX(2), barTileY(1) },   // WARMUP
+    { barTileX(3), barTileY(1) } }, // LAUNCH
+};
+
+static void build_ring_gauge(lv_obj_t* parent);
+static void build_bar_view(lv_obj_t* parent);
+static void gauge_redraw();
+static void apply_stats_overlay();
+
+template <const ViewLayout& L, void (*BuildGauge)(lv_obj_t*)>
+static void build_view(lv_obj_t* parent) {
+  BuildGauge(parent);
+  for (int i = 0; i < TILE_COUNT; i++) make_tile(*tiles_all[i], parent, L, L.tiles[i], TILE_DEFS[i]);
+}
+
+static void teardown_view() {
+  lv_obj_clean(cont_view);
+  for (int i = 0; i < TILE_COUNT; i++) {
+    lv_style_reset(&tiles_all[i]->st_ind);   // its objects are gone, free the style's props
+    *tiles_all[i] = TileUI{};
   }
+  meter_rpm = nullptr;
+  meter_scale_rpm = nullptr;
+  meter_arc_green = meter_arc_yellow = meter_arc_red = meter_arc_shift = meter_needle = nullptr;
+  ring_face = ring_needle = nullptr;
+  ring_face_shift = INT_MIN;
+  lbl_rpm = nullptr;
+  cont_bar = bar_rpm = lbl_rpm_bar = nullptr;
+  bar_zone = 0xFF;
+}
+
+static uint8_t builtView = 0xFF;
+
+// Called on every settings apply; only rebuilds when the view actually changed.
+static void apply_view_layout() {
+  if (!cont_view || builtView == setting_viewMode) return;
+  teardown_view();
+  if (setting_viewMode == VIEW_BAR) build_view<BAR_LAYOUT, build_bar_view>(cont_view);
+  else                              build_view<RING_LAYOUT, build_ring_gauge>(cont_view);
+  builtView = setting_viewMode;
+  prev = PrevData();   // fresh widgets: redraw everything on the next update
+  gauge_redraw();
 }
 
-static void layout_tiles_ring() {
-  const int TILE_W = 105, TILE_H = 70, GAP_Y = 6;
-  const int L_X = 4;
-  const int R_X = SCREEN_W - 8 - TILE_W;
-  const int TOP_Y = STATUS_H + 6;
+// ============================= Dash pages =============================
+// Page 0 is the main view above (cont_view); swiping left / right on the dash steps through
+// PAGES after it. A page's tiles are made on its first visit, inside cont_pages, and only
+// hidden when another page shows, so coming back is free. Before a page is built, and after
+// every switch, cached pages are freed least recently shown first until the LVGL heap has
+// PAGE_MIN_FREE_BYTES again; a freed page is simply rebuilt on its next visit.
+// update_dash_values() only touches the visible page.
+static const uint8_t PAGE_MAX_TILES = 12;   // 4 x 3 grid
+static const uint32_t PAGE_MIN_FREE_BYTES = 12 * 1024;
+
+struct PageDef {
+  const char* title;
+  uint8_t count;
+  TileDef tiles[PAGE_MAX_TILES];
+};
+
+static const PageDef PAGES[] = {
+  { "LAUNCH", 10, {
+    { "RPM",     "",      C_GREEN, CH_RPM,       0.0f,   8000.0f, 0, false },
+    { "TPS",     "%",     C_GREEN, CH_TPS,       0.0f,   100.0f,  0, false },
+    { "MAP",     "kPa",   C_YELL,  CH_MAP,       0.0f,   250.0f,  0, false },
+    { "BOOST T", "kPa",   C_YELL,  CH_BOOSTTGT,  0.0f,   250.0f,  0, false },
+    { "BOOST %", "%",     C_AMBER, CH_BOOSTDUTY, 0.0f,   100.0f,  0, false },
+    { "ADV",     "deg",   C_YELL,  CH_ADV,       -10.0f, 50.0f,   0, false },
+    { "AFR",     "",      C_YELL,  CH_AFR,       9.0f,   20.0f,   2, false },
+    { "RPM/s",   "",      C_AMBER, CH_RPMDOT,    -5000.0f, 5000.0f, 0, false },
+    { "TPS/s",   "%/s",   C_AMBER, CH_TPSDOT,    0.0f,   2000.0f, 0, false },
+    { "LAUNCH",  "",      C_RED,   CH_LAUNCH,    0.0f,   1.0f,    0, true  } } },
+  { "WARMUP", 10, {
+    { "CLT",     "C",     C_AMBER, CH_CLT,       0.0f,   120.0f,  0, false },
+    { "IAT",     "C",     C_AMBER, CH_IAT,       -20.0f, 80.0f,   0, false },
+    { "WUE",     "%",     C_AMBER, CH_WUE,       100.0f, 200.0f,  0, false },
+    { "WARMUP",  "",      C_AMBER, CH_WARMUP,    0.0f,   1.0f,    0, true  },
+    { "AFR",     "",      C_YELL,  CH_AFR,       9.0f,   20.0f,   2, false },
+    { "AFR TGT", "",      C_YELL,  CH_AFRTGT,    9.0f,   20.0f,   1, false },
+    { "EGO",     "%",     C_GREEN, CH_EGOCOR,    50.0f,  150.0f,  0, false },
+    { "IDLE",    "%",     C_GREEN, CH_IDLELOAD,  0.0f,   100.0f,  0, false },
+    { "VBAT",    "V",     C_GREEN, CH_VBAT,      10.0f,  15.5f,   1, false },
+    { "BAT COR", "%",     C_GREEN, CH_BATCOR,    50.0f,  150.0f,  0, false } } },
+  { "DIAG", 12, {
+    { "LOOPS",   "/s",    C_GREEN, CH_LOOPS,     0.0f,   5000.0f, 0, false },
+    { "FREE RAM","B",     C_GREEN, CH_FREERAM,   0.0f,   8192.0f, 0, false },
+    { "SECL",    "s",     C_BLUEG, CH_SECL,      0.0f,   255.0f,  0, false },
+    { "PW1",     "ms",    C_YELL,  CH_PW1,       0.0f,   20.0f,   2, false },
+    { "DWELL",   "ms",    C_YELL,  CH_DWELL,     0.0f,   10.0f,   1, false },
+    { "VE",      "%",     C_YELL,  CH_VE,        0.0f,   150.0f,  0, false },
+    { "GAMMA",   "%",     C_AMBER, CH_GAMMAE,    50.0f,  200.0f,  0, false },
+    { "BARO",    "kPa",   C_GREEN, CH_BARO,      70.0f,  110.0f,  0, false },
+    { "ETHANOL", "%",     C_GREEN, CH_ETHANOL,   0.0f,   100.0f,  0, false },
+    { "FLEX",    "%",     C_AMBER, CH_FLEXCOR,   50.0f,  150.0f,  0, false },
+    { "IAT COR", "%",     C_AMBER, CH_IATCOR,    50.0f,  150.0f,  0, false },
+    { "AFR2",    "",      C_YELL,  CH_AFR2,      9.0f,   20.0f,   1, false } } },
+};
+static const uint8_t PAGE_COUNT = sizeof(PAGES) / sizeof(PAGES[0]);   // besides page 0
+
+static const int16_t PAGE_TILE_W = 114, PAGE_TILE_H = 70, PAGE_GAP_X = 6, PAGE_GAP_Y = 8;
+static constexpr ViewLayout PAGE_LAYOUT = {   // tile size only; slots come from pageSlot()
+  PAGE_TILE_W, PAGE_TILE_H, PAGE_TILE_W - 20, &lv_font_montserrat_12, &lv_font_montserrat_22, {},
+};
+static constexpr TileSlot pageSlot(int i) {
+  return { (int16_t)((SCREEN_W - (4 * PAGE_TILE_W + 3 * PAGE_GAP_X)) / 2 + (PAGE_TILE_W + PAGE_GAP_X) * (i % 4)),
+           (int16_t)(STATUS_H + 24 + (PAGE_TILE_H + PAGE_GAP_Y) * (i / 4)) };
+}
 
-  lv_obj_set_pos(ui_afr.cont,   L_X, TOP_Y + (TILE_H+GAP_Y)*0);
-  lv_obj_set_pos(ui_vbat.cont,  L_X, TOP_Y + (TILE_H+GAP_Y)*1);
-  lv_obj_set_pos(ui_iat.cont,   L_X, TOP_Y + (TILE_H+GAP_Y)*2);
-  lv_obj_set_pos(ui_clt.cont,   L_X, TOP_Y + (TILE_H+GAP_Y)*3);
+// One cached page: its container (nullptr: not built) and tile objects.
+struct PageUI {
+  lv_obj_t* cont;
+  TileUI tiles[PAGE_MAX_TILES];
+  int32_t prev[PAGE_MAX_TILES];   // last drawn value, as PrevData.tile
+  uint16_t prevWarn;
+  uint32_t shownMs;               // LRU stamp
+};
+static PageUI pageUi[PAGE_COUNT];
+static lv_obj_t* cont_pages = nullptr;   // parent of every built page, above cont_view
+static uint8_t curPage = 0;              // 0: main view, n: PAGES[n - 1]
 
-  lv_obj_set_pos(ui_tps.cont,   R_X, TOP_Y + (TILE_H+GAP_Y)*0);
-  lv_obj_set_pos(ui_adv.cont,   R_X, TOP_Y + (TILE_H+GAP_Y)*1);
-  lv_obj_set_pos(ui_warm.cont,  R_X, TOP_Y + (TILE_H+GAP_Y)*2);
-  lv_obj_set_pos(ui_launch.cont,R_X, TOP_Y + (TILE_H+GAP_Y)*3);
-  if (cont_bar) { lv_obj_add_flag(cont_bar, LV_OBJ_FLAG_HIDDEN); }
-  if (meter_rpm) { lv_obj_clear_flag(meter_rpm, LV_OBJ_FLAG_HIDDEN); }
-  if (lbl_rpm)   { lv_obj_clear_flag(lbl_rpm, LV_OBJ_FLAG_HIDDEN); }
+static void page_invalidate(PageUI& pg) {
+  for (int i = 0; i < PAGE_MAX_TILES; i++) pg.prev[i] = INT32_MIN;
+  pg.prevWarn = UINT16_MAX;
 }
 
-static void layout_tiles_bar() {
-  const int tileW = 114;
-  const int tileH = 70;
-  const int gapX  = 6;
-  const int gapY  = 8;
+static void page_build(uint8_t idx) {
+  const PageDef& def = PAGES[idx];
+  PageUI& pg = pageUi[idx];
+  pg.cont = lv_obj_create(cont_pages);
+  lv_obj_set_pos(pg.cont, 0, 0);
+  lv_obj_set_size(pg.cont, SCREEN_W, SCREEN_H);
+  lv_obj_set_style_bg_opa(pg.cont, LV_OPA_TRANSP, 0);
+  lv_obj_set_style_border_width(pg.cont, 0, 0);
+  lv_obj_set_style_radius(pg.cont, 0, 0);
+  lv_obj_set_style_pad_all(pg.cont, 0, 0);
+  lv_obj_clear_flag(pg.cont, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_clear_flag(pg.cont, LV_OBJ_FLAG_CLICKABLE);
+
+  char title[24];
+  snprintf(title, sizeof(title), "%s  %u/%u", def.title, (unsigned)(idx + 2), (unsigned)(PAGE_COUNT + 1));
+  lv_obj_t* lbl = lv_label_create(pg.cont);
+  lv_label_set_text(lbl, title);
+  lv_obj_set_style_text_color(lbl, lvcol(C_MUTED), 0);
+  lv_obj_set_style_text_font(lbl, &lv_font_montserrat_14, 0);
+  lv_obj_set_pos(lbl, pageSlot(0).x, STATUS_H + 4);
+
+  for (int i = 0; i < def.count; i++) make_tile(pg.tiles[i], pg.cont, PAGE_LAYOUT, pageSlot(i), def.tiles[i]);
+  page_invalidate(pg);
+}
 
-  const int cols = 4;
-  const int totalW = cols * tileW + (cols - 1) * gapX;
-  const int startX = (SCREEN_W - totalW) / 2;
+static void page_free(uint8_t idx) {
+  PageUI& pg = pageUi[idx];
+  if (!pg.cont) return;
+  lv_obj_del(pg.cont);
+  for (int i = 0; i < PAGES[idx].count; i++) {
+    lv_style_reset(&pg.tiles[i].st_ind);
+    pg.tiles[i] = TileUI{};
+  }
+  pg.cont = nullptr;
+}
 
-  const int row1Y = STATUS_H + 110;
-  const int row2Y = row1Y + tileH + gapY;
+static uint32_t lvgl_free_bytes() {
+  lv_mem_monitor_t m;
+  lv_mem_monitor(&m);
+  return m.free_size;
+}
 
-  lv_obj_set_pos(ui_afr.cont,   startX + (tileW+gapX)*0, row1Y);
-  lv_obj_set_pos(ui_vbat.cont,  startX + (tileW+gapX)*1, row1Y);
-  lv_obj_set_pos(ui_tps.cont,   startX + (tileW+gapX)*2, row1Y);
-  lv_obj_set_pos(ui_adv.cont,   startX + (tileW+gapX)*3, row1Y);
+// Frees hidden pages, least recently shown first, until the LVGL heap is above the floor.
+static void pages_trim() {
+  while (lvgl_free_bytes() < PAGE_MIN_FREE_BYTES) {
+    int lru = -1;
+    for (int i = 0; i < PAGE_COUNT; i++) {
+      if (!pageUi[i].cont || i + 1 == curPage) continue;
+      if (lru < 0 || (int32_t)(pageUi[i].shownMs - pageUi[lru].shownMs) < 0) lru = i;
+    }
+    if (lru < 0) return;
+    page_free((uint8_t)lru);
+  }
+}
 
-  lv_obj_set_pos(ui_iat.cont,   startX + (tileW+gapX)*0, row2Y);
-  lv_obj_set_pos(ui_clt.cont,   startX + (tileW+gapX)*1, row2Y);
-  lv_obj_set_pos(ui_warm.cont,  startX + (tileW+gapX)*2, row2Y);
-  lv_obj_set_pos(ui_launch.cont,startX + (tileW+gapX)*3, row2Y);
+static void show_page(uint8_t p) {
+  if (p > PAGE_COUNT || p == curPage || !cont_view) return;
+  if (curPage == 0) lv_obj_add_flag(cont_view, LV_OBJ_FLAG_HIDDEN);
+  else if (pageUi[curPage - 1].cont) lv_obj_add_flag(pageUi[curPage - 1].cont, LV_OBJ_FLAG_HIDDEN);
+  curPage = p;
 
-  for (int i=0;i<8;i++){
-    lv_obj_set_size(tiles_all[i]->cont, tileW, tileH);
-    lv_obj_set_width(tiles_all[i]->bar, tileW - 20);
+  if (p == 0) {
+    lv_obj_clear_flag(cont_view, LV_OBJ_FLAG_HIDDEN);
+    prev = PrevData();   // skipped while hidden: redraw everything
+    gauge_redraw();
+  } else {
+    PageUI& pg = pageUi[p - 1];
+    if (!pg.cont) {
+      pages_trim();
+      page_build(p - 1);
+    } else {
+      lv_obj_clear_flag(pg.cont, LV_OBJ_FLAG_HIDDEN);
+      page_invalidate(pg);
+    }
+    pg.shownMs = millis();
   }
-  if (cont_bar) { lv_obj_clear_flag(cont_bar, LV_OBJ_FLAG_HIDDEN); }
-  if (meter_rpm) { lv_obj_add_flag(meter_rpm, LV_OBJ_FLAG_HIDDEN); }
-  if (lbl_rpm)   { lv_obj_add_flag(lbl_rpm, LV_OBJ_FLAG_HIDDEN); }
+  pages_trim();
+}
+
+// Scr_dash gesture: left = next page, right = previous (wrapping).
+static void dash_gesture_cb(lv_event_t* e) {
+  (void)e;
+  const lv_dir_t dir = lv_indev_get_gesture_dir(lv_indev_get_act());
+  const uint8_t n = PAGE_COUNT + 1;
+  if (dir == LV_DIR_LEFT)       show_page((uint8_t)((curPage + 1) % n));
+  else if (dir == LV_DIR_RIGHT) show_page((uint8_t)((curPage + n - 1) % n));
 }
 
 // ============================= UI: status bar =============================
@@ -843,13 +3324,25 @@ static void build_status_bar(lv_obj_t* parent) {
   lv_label_set_text(lbl_rx, "RX:0");
   lv_obj_set_style_text_font(lbl_rx, &lv_font_montserrat_12, 0);
   lv_obj_set_style_text_color(lbl_rx, lv_color_white(), 0);
-  lv_obj_align(lbl_rx, LV_ALIGN_LEFT_MID, 120, 0);
+  lv_obj_align(lbl_rx, LV_ALIGN_LEFT_MID, 96, 0);
 
   lbl_age = lv_label_create(bar);
   lv_label_set_text(lbl_age, "Age:0ms");
   lv_obj_set_style_text_font(lbl_age, &lv_font_montserrat_12, 0);
   lv_obj_set_style_text_color(lbl_age, lv_color_white(), 0);
-  lv_obj_align(lbl_age, LV_ALIGN_LEFT_MID, 220, 0);
+  lv_obj_align(lbl_age, LV_ALIGN_LEFT_MID, 168, 0);
+
+  lbl_rtt = lv_label_create(bar);
+  lv_label_set_text(lbl_rtt, "RTT:--");
+  lv_obj_set_style_text_font(lbl_rtt, &lv_font_montserrat_12, 0);
+  lv_obj_set_style_text_color(lbl_rtt, lv_color_white(), 0);
+  lv_obj_align(lbl_rtt, LV_ALIGN_LEFT_MID, 232, 0);
+
+  lbl_logq = lv_label_create(bar);
+  lv_label_set_text(lbl_logq, "");
+  lv_obj_set_style_text_font(lbl_logq, &lv_font_montserrat_12, 0);
+  lv_obj_set_style_text_color(lbl_logq, lvcol(C_AMBER), 0);
+  lv_obj_align(lbl_logq, LV_ALIGN_LEFT_MID, 304, 0);
 
   lbl_sd = lv_label_create(bar);
   lv_label_set_text(lbl_sd, "SD:--");
@@ -932,18 +3425,24 @@ static void build_bar_view(lv_obj_t* parent) {
   lv_obj_align(lbl_rpm_bar, LV_ALIGN_TOP_MID, 0, 48);
 }
 
-static void update_bar_rpm(int rpm) {
+// Fill and zone colour; driven by gauge_animate(). The colour style is only touched on a zone change.
+static void update_bar_fill(int rpm) {
   rpm = clampi(rpm, 0, RPM_MAX);
   if (!bar_rpm) return;
 
   lv_bar_set_value(bar_rpm, rpm, LV_ANIM_OFF);
 
-  if (rpm >= RPM_REDLINE) lv_obj_set_style_bg_color(bar_rpm, lvcol(C_RED), LV_PART_INDICATOR);
-  else if (rpm >= RPM_YELLOW) lv_obj_set_style_bg_color(bar_rpm, lvcol(C_YELL), LV_PART_INDICATOR);
-  else lv_obj_set_style_bg_color(bar_rpm, lvcol(C_GREEN), LV_PART_INDICATOR);
+  const uint8_t z = (rpm >= RPM_REDLINE) ? 2 : (rpm >= RPM_YELLOW) ? 1 : 0;
+  if (z == bar_zone) return;
+  bar_zone = z;
+  static const uint16_t ZONE_565[3] = { C_GREEN, C_YELL, C_RED };
+  lv_obj_set_style_bg_color(bar_rpm, lvcol(ZONE_565[z]), LV_PART_INDICATOR);
+}
 
+static void update_bar_label(int rpm) {
+  if (!lbl_rpm_bar) return;
   static char buf[20];
-  snprintf(buf, sizeof(buf), "%d RPM", rpm);
+  snprintf(buf, sizeof(buf), "%d RPM", clampi(rpm, 0, RPM_MAX));
   lv_label_set_text(lbl_rpm_bar, buf);
 }
 
@@ -973,10 +3472,8 @@ static void toast_timer_cb(lv_timer_t* t) {
   lv_timer_del(t);
 }
 
-static void showToast(const char* title, const char* msg) {
+static void showToast(const char* title, const char* msg, uint32_t showMs) {
   if (!lvReady) return;
-  // If we're in portalMode, LVGL is stopped; don't create popups.
-  if (portalMode) return;
 
   if (mbox_toast) { lv_obj_del_async(mbox_toast); mbox_toast = nullptr; }
 
@@ -985,10 +3482,32 @@ static void showToast(const char* title, const char* msg) {
   lv_obj_center(mbox_toast);
   lv_obj_add_event_cb(mbox_toast, toast_deleted_cb, LV_EVENT_DELETE, nullptr);
 
-  lv_timer_t* t = lv_timer_create(toast_timer_cb, 1800, nullptr);
+  lv_timer_t* t = lv_timer_create(toast_timer_cb, showMs, nullptr);
   lv_timer_set_repeat_count(t, 1);
 }
 
+#if USE_SD
+// Headline numbers of the session that just closed (render task, on UI_REQ_SUMMARY).
+static void showSessionSummary() {
+  sdLock();
+  const uint32_t n = logSumLast.samples, dur = logSumLast.durationMs;
+  const int32_t maxRpm = n ? logSumLast.chMax[CH_RPM] : 0;
+  const int32_t maxClt = n ? logSumLast.chMax[CH_CLT] : 0;
+  const int16_t minAfr = logSess.minAfrX100;
+  uint32_t warnMs = 0;
+  for (int w = 0; w < W_COUNT; w++) warnMs += logSumLast.warnMs[w];
+  sdUnlock();
+
+  char afr[12] = "-";
+  if (minAfr != INT16_MAX) formatFixed(afr, sizeof(afr), minAfr, 2);
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%lu:%02lu, %lu samples\nMax RPM %ld   Min AFR %s\nMax CLT %ld C   Warn %lu.%lu s",
+           (unsigned long)(dur / 60000), (unsigned long)(dur / 1000 % 60), (unsigned long)n, (long)maxRpm, afr,
+           (long)maxClt, (unsigned long)(warnMs / 1000), (unsigned long)(warnMs / 100 % 10));
+  showToast("SESSION", msg, 6000);
+}
+#endif
+
 // ============================= UI events =============================
 static void refresh_settings_list();
 
@@ -996,10 +3515,14 @@ static float warnStep(int row) {
   switch (row) {
     case W_AFR:  return 0.1f;
     case W_VBAT: return 0.1f;
+    case W_CLT_RATE: return 0.1f;
     default:     return 1.0f;
   }
 }
 
+// Fractional limits are shown (LVGL and portal) with one decimal, the rest as integers.
+static bool warnOneDec(int id) { return warnStep(id) < 1.0f; }
+
 static const char* warnName(int id) {
   switch(id){
     case W_AFR: return "AFR";
@@ -1008,12 +3531,13 @@ static const char* warnName(int id) {
     case W_CLT: return "CLT";
     case W_TPS: return "TPS";
     case W_ADV: return "ADV";
+    case W_CLT_RATE: return "CLT/s";
     default: return "?";
   }
 }
 
 static void format_warn_range(int i, char* out, size_t outSz) {
-  const bool oneDec = (i == W_AFR || i == W_VBAT);
+  const bool oneDec = warnOneDec(i);
   const char* which = editMin ? "MIN" : "MAX";
   if (oneDec) {
     snprintf(out, outSz, "%s %.1f..%.1f", which, warnCfg[i].minV, warnCfg[i].maxV);
@@ -1071,7 +3595,7 @@ static void btn_event_cb(lv_event_t* e) {
   } else if (obj == btn_back) {
     lv_scr_load(scr_dash);
   } else if (obj == btn_save) {
-    saveSettings();
+    settingsChanged();
     flashSaved();
   } else if (obj == btn_clear) {
     showDefaultConfirm();
@@ -1096,7 +3620,8 @@ static void btn_event_cb(lv_event_t* e) {
       setting_viewMode = (setting_viewMode == VIEW_RING) ? VIEW_BAR : VIEW_RING;
       apply_view_layout();
     } else {
-      // LOGGING row: +/- do nothing
+      // LOGGING row: +/- cycles CSV/BIN/DELTA (applies to the next recording)
+      setting_logFmt = (uint8_t)((setting_logFmt + 1) % LOG_FMT_COUNT);
     }
 
     refresh_settings_list();
@@ -1134,78 +3659,261 @@ static void settings_switch_cb(lv_event_t* e) {
 }
 
 // ============================= UI: build DASH =============================
-static void build_dash() {
-  scr_dash = lv_obj_create(NULL);
-  lv_obj_set_style_bg_color(scr_dash, lvcol(C_BG), 0);
-  lv_obj_clear_flag(scr_dash, LV_OBJ_FLAG_SCROLLABLE);
+// ---- Ring gauge ----
+// The face (scale, ticks, zone arcs, shift marker) never changes while driving, so it is drawn
+// once with lv_meter, captured with lv_snapshot into a PSRAM image and the meter deleted. Needle
+// moves then only invalidate the needle's own bounding box (an lv_line over the image) instead
+// of making lv_meter redraw every tick, arc and label under it. The face is re-captured when
+// the shift marker moves (ring_face_refresh()). If the capture fails the live meter is kept.
+static const int RING_CX = 240, RING_CY = 150, RING_R = 122;
+static const int RING_NEEDLE_LEN = RING_R - 10;
+static const int RING_SHIFT_MARK_RPM = 80;   // width of the shift marker on the scale
+
+static lv_point_t ring_needle_pts[2];
+static lv_img_dsc_t ring_face_dsc;
+static uint8_t* ring_face_buf = nullptr;
+static bool ring_face_failed = false;   // a capture failed once: keep what is shown, don't retry
+
+static int ring_shift_mark() { return setting_shiftEnabled ? clampi(setting_shiftRpm, 0, RPM_MAX - RING_SHIFT_MARK_RPM) : -1; }
+
+static void ring_set_shift_arc(lv_obj_t* m, lv_meter_indicator_t* arc, int mark) {
+  lv_meter_set_indicator_start_value(m, arc, mark < 0 ? 0 : mark);
+  lv_meter_set_indicator_end_value  (m, arc, mark < 0 ? 0 : mark + RING_SHIFT_MARK_RPM);
+}
 
-  build_status_bar(scr_dash);
+static lv_obj_t* make_meter_face(lv_obj_t* parent, lv_meter_scale_t** scaleOut, lv_meter_indicator_t** shiftOut) {
+  lv_obj_t* m = lv_meter_create(parent);
+  lv_obj_set_size(m, RING_R*2, RING_R*2);
+  lv_obj_set_pos(m, RING_CX - RING_R, RING_CY - RING_R);
 
-  // Web mode banner (hidden by default)
-  lbl_webmode = lv_label_create(scr_dash);
-  lv_label_set_text(lbl_webmode, "WEB CONFIG MODE");
-  lv_obj_set_style_text_font(lbl_webmode, &lv_font_montserrat_16, 0);
-  lv_obj_set_style_text_color(lbl_webmode, lvcol(C_GREEN), 0);
-  lv_obj_align(lbl_webmode, LV_ALIGN_TOP_MID, 0, STATUS_H + 4);
-  lv_obj_add_flag(lbl_webmode, LV_OBJ_FLAG_HIDDEN);
+  // Transparent background, no border
+  lv_obj_set_style_bg_opa(m, LV_OPA_TRANSP, 0);
+  lv_obj_set_style_border_width(m, 0, 0);
+  lv_obj_set_style_pad_all(m, 0, 0);
+  lv_obj_clear_flag(m, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_clear_flag(m, LV_OBJ_FLAG_CLICKABLE);
 
-  // Traditional RPM gauge (meter + needle)
-const int cx = 240, cy = 150;
-const int r  = 122;
+  lv_meter_scale_t* scale = lv_meter_add_scale(m);
 
-meter_rpm = lv_meter_create(scr_dash);
-lv_obj_set_size(meter_rpm, r*2, r*2);
-lv_obj_set_pos(meter_rpm, cx - r, cy - r);
+  // 240-degree sweep starting at 150deg (matches old ring 150..390)
+  lv_meter_set_scale_range(m, scale, 0, RPM_MAX, 240, 150);
 
-// Transparent background, no border
-lv_obj_set_style_bg_opa(meter_rpm, LV_OPA_TRANSP, 0);
-lv_obj_set_style_border_width(meter_rpm, 0, 0);
-lv_obj_set_style_pad_all(meter_rpm, 0, 0);
-lv_obj_clear_flag(meter_rpm, LV_OBJ_FLAG_SCROLLABLE);
-lv_obj_clear_flag(meter_rpm, LV_OBJ_FLAG_CLICKABLE);
+  // Ticks
+  lv_meter_set_scale_ticks(m, scale, 41, 2, 10, lvcol(C_MUTED));
+  lv_meter_set_scale_major_ticks(m, scale, 8, 4, 15, lvcol(C_TEXT), 12);
 
-meter_scale_rpm = lv_meter_add_scale(meter_rpm);
+  // Colored arcs: green -> yellow -> red
+  meter_arc_green  = lv_meter_add_arc(m, scale, 14, lvcol(C_BLUEG), 0);
+  lv_meter_set_indicator_start_value(m, meter_arc_green, 0);
+  lv_meter_set_indicator_end_value  (m, meter_arc_green, RPM_YELLOW);
 
-// 240-degree sweep starting at 150deg (matches old ring 150..390)
-lv_meter_set_scale_range(meter_rpm, meter_scale_rpm, 0, RPM_MAX, 240, 150);
+  meter_arc_yellow = lv_meter_add_arc(m, scale, 14, lvcol(C_YELL), 0);
+  lv_meter_set_indicator_start_value(m, meter_arc_yellow, RPM_YELLOW);
+  lv_meter_set_indicator_end_value  (m, meter_arc_yellow, RPM_REDLINE);
+
+  meter_arc_red    = lv_meter_add_arc(m, scale, 14, lvcol(C_RED), 0);
+  lv_meter_set_indicator_start_value(m, meter_arc_red, RPM_REDLINE);
+  lv_meter_set_indicator_end_value  (m, meter_arc_red, RPM_MAX);
+
+  // Shift point marker
+  lv_meter_indicator_t* shift = lv_meter_add_arc(m, scale, 14, lv_color_white(), 0);
+  ring_set_shift_arc(m, shift, ring_shift_mark());
+
+  if (scaleOut) *scaleOut = scale;
+  if (shiftOut) *shiftOut = shift;
+  return m;
+}
 
-// Ticks
-lv_meter_set_scale_ticks(meter_rpm, meter_scale_rpm, 41, 2, 10, lvcol(C_MUTED));
-lv_meter_set_scale_major_ticks(meter_rpm, meter_scale_rpm, 8, 4, 15, lvcol(C_TEXT), 12);
+#if LV_USE_SNAPSHOT
+// Draws a throwaway meter into a new buffer and swaps it in as ring_face_dsc. The face on
+// screen keeps the old buffer until then, so a failure leaves it intact. false: no memory /
+// snapshot failed (latched, so later calls return false at once).
+static bool ring_face_capture(lv_obj_t* parent) {
+  if (ring_face_failed) return false;
+  lv_obj_t* m = make_meter_face(parent, nullptr, nullptr);
+  lv_obj_update_layout(m);
+  const uint32_t need = lv_snapshot_buf_size_needed(m, LV_IMG_CF_TRUE_COLOR_ALPHA);
+  uint8_t* buf = (uint8_t*)heap_caps_malloc(need, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  lv_img_dsc_t dsc;
+  const bool ok = buf && lv_snapshot_take_to_buf(m, LV_IMG_CF_TRUE_COLOR_ALPHA, &dsc, buf, need) == LV_RES_OK;
+  lv_obj_del(m);
+  meter_arc_green = meter_arc_yellow = meter_arc_red = nullptr;
+  if (!ok) {
+    if (buf) heap_caps_free(buf);
+    ring_face_failed = true;
+    return false;
+  }
+  if (ring_face_buf) heap_caps_free(ring_face_buf);
+  ring_face_buf = buf;
+  ring_face_dsc = dsc;
+  ring_face_shift = ring_shift_mark();
+  return true;
+}
+#endif
 
-// Colored arcs: green -> yellow -> red
-meter_arc_green  = lv_meter_add_arc(meter_rpm, meter_scale_rpm, 14, lvcol(C_BLUEG), 0);
-lv_meter_set_indicator_start_value(meter_rpm, meter_arc_green, 0);
-lv_meter_set_indicator_end_value  (meter_rpm, meter_arc_green, RPM_YELLOW);
+// rpm -> needle tip, same geometry as the meter's scale (150deg + 240deg sweep, clockwise).
+static void ring_needle_update(int rpm) {
+  const float a = (150.0f + 240.0f * (float)clampi(rpm, 0, RPM_MAX) / (float)RPM_MAX) * (float)M_PI / 180.0f;
+  const int tx = RING_CX + (int)lroundf(cosf(a) * RING_NEEDLE_LEN);
+  const int ty = RING_CY + (int)lroundf(sinf(a) * RING_NEEDLE_LEN);
+  // Keep the line object tight around the needle so only that box is invalidated.
+  const int x0 = min(RING_CX, tx), y0 = min(RING_CY, ty);
+  ring_needle_pts[0] = { (lv_coord_t)(RING_CX - x0), (lv_coord_t)(RING_CY - y0) };
+  ring_needle_pts[1] = { (lv_coord_t)(tx - x0), (lv_coord_t)(ty - y0) };
+  lv_obj_set_pos(ring_needle, x0, y0);
+  lv_line_set_points(ring_needle, ring_needle_pts, 2);
+}
 
-meter_arc_yellow = lv_meter_add_arc(meter_rpm, meter_scale_rpm, 14, lvcol(C_YELL), 0);
-lv_meter_set_indicator_start_value(meter_rpm, meter_arc_yellow, RPM_YELLOW);
-lv_meter_set_indicator_end_value  (meter_rpm, meter_arc_yellow, RPM_REDLINE);
+static void set_ring_rpm(int rpm) {
+  if (ring_needle) ring_needle_update(rpm);
+  else if (meter_rpm && meter_needle) lv_meter_set_indicator_value(meter_rpm, meter_needle, rpm);
+}
 
-meter_arc_red    = lv_meter_add_arc(meter_rpm, meter_scale_rpm, 14, lvcol(C_RED), 0);
-lv_meter_set_indicator_start_value(meter_rpm, meter_arc_red, RPM_REDLINE);
-lv_meter_set_indicator_end_value  (meter_rpm, meter_arc_red, RPM_MAX);
+// Render task, every UI update: follows setting_shiftRpm / setting_shiftEnabled.
+static void ring_face_refresh() {
+  const int mark = ring_shift_mark();
+  if (mark == ring_face_shift) return;
+  if (meter_rpm && meter_arc_shift) {
+    ring_set_shift_arc(meter_rpm, meter_arc_shift, mark);
+    ring_face_shift = mark;
+  }
+#if LV_USE_SNAPSHOT
+  else if (ring_face && ring_face_capture(cont_view)) {
+    lv_img_cache_invalidate_src(&ring_face_dsc);
+    lv_obj_invalidate(ring_face);
+  }
+#endif
+}
 
-// Needle
-meter_needle = lv_meter_add_needle_line(meter_rpm, meter_scale_rpm, 4, lvcol(C_RED), -10);
-lv_meter_set_indicator_value(meter_rpm, meter_needle, 0);
+static void build_ring_gauge(lv_obj_t* parent) {
+#if LV_USE_SNAPSHOT
+  if (ring_face_capture(parent)) {
+    ring_face = lv_img_create(parent);
+    lv_img_set_src(ring_face, &ring_face_dsc);
+    // The snapshot includes the meter's extra draw area around it, so centre it on the meter.
+    lv_obj_set_pos(ring_face, RING_CX - (int)ring_face_dsc.header.w / 2, RING_CY - (int)ring_face_dsc.header.h / 2);
+
+    ring_needle = lv_line_create(parent);
+    lv_obj_set_style_line_width(ring_needle, 4, 0);
+    lv_obj_set_style_line_color(ring_needle, lvcol(C_RED), 0);
+    lv_obj_set_style_line_rounded(ring_needle, true, 0);
+    lv_obj_clear_flag(ring_needle, LV_OBJ_FLAG_CLICKABLE);
+    ring_needle_update(0);
+  } else
+#endif
+  {
+    meter_rpm = make_meter_face(parent, &meter_scale_rpm, &meter_arc_shift);
+    ring_face_shift = ring_shift_mark();
+    meter_needle = lv_meter_add_needle_line(meter_rpm, meter_scale_rpm, 4, lvcol(C_RED), -10);
+    lv_meter_set_indicator_value(meter_rpm, meter_needle, 0);
+  }
 
-lbl_rpm = lv_label_create(scr_dash);
+  lbl_rpm = lv_label_create(parent);
   lv_label_set_text(lbl_rpm, "0");
   lv_obj_set_style_text_font(lbl_rpm, &lv_font_montserrat_48, 0);
   lv_obj_set_style_text_color(lbl_rpm, lvcol(C_TEXT), 0);
   lv_obj_align(lbl_rpm, LV_ALIGN_CENTER, 0, 52);
+}
+
+// ============================= Gauge animation =============================
+// Needle and rpm bar run at display rate from a render-side model instead of stepping with
+// each ECU frame. Every new frame is a sample (rpm, receive time); between samples the target
+// is extrapolated along the slope of the last two, at most GAUGE_EXTRAP_MAX_MS ahead, and the
+// drawn value follows it through a critically damped spring with time constant
+// setting_gaugeSmoothMs (0: draw the target as is). No extra ECU traffic is needed.
+// Drawing is capped: steps under GAUGE_MIN_STEP_RPM are skipped, and while an LVGL pass takes
+// more than GAUGE_FRAME_BUDGET_US the animation drops to every other frame.
+static const uint32_t GAUGE_FRAME_MS = 16;
+static const uint32_t GAUGE_EXTRAP_MAX_MS = 100;
+static const uint32_t GAUGE_SAMPLE_GAP_MS = 500;    // older previous sample: no slope
+static const uint32_t GAUGE_FRAME_BUDGET_US = 4000;
+static const float GAUGE_MIN_STEP_RPM = (float)RPM_MAX / 960.0f;   // ~0.25 deg of sweep, 1/2 px of bar
+
+struct GaugeModel {
+  uint32_t sampleMs = 0;
+  float sample = 0, slope = 0;   // rpm, rpm/ms
+  float x = 0, v = 0;            // drawn value (rpm) and its velocity (rpm/ms)
+  float drawn = -1.0f;           // < 0: redraw on the next step
+  uint32_t stepMs = 0;
+};
+static GaugeModel gauge;
+static uint32_t lvglPassUs = 0;  // last lv_timer_handler() duration (dashLoop)
+
+static void gauge_redraw() { gauge.drawn = -1.0f; }
+
+static void gauge_sample(const EcuData& ecu) {
+  if (!linkValid || !(ecuFreshMask(ecu, millis()) & chBit(CH_RPM))) { gauge.sample = 0; gauge.slope = 0; return; }
+  if (ecu.lastUpdateMs == gauge.sampleMs) return;
+  const float rpm = (float)clampi(chInt(ecu, CH_RPM), 0, RPM_MAX);
+  const uint32_t dt = ecu.lastUpdateMs - gauge.sampleMs;
+  gauge.slope = (gauge.sampleMs != 0 && dt > 0 && dt < GAUGE_SAMPLE_GAP_MS) ? (rpm - gauge.sample) / (float)dt : 0.0f;
+  gauge.sample = rpm;
+  gauge.sampleMs = ecu.lastUpdateMs;
+}
+
+// Render task, every dashLoop pass while scr_dash is shown.
+static void gauge_animate() {
+  const uint32_t now = millis();
+  const uint32_t gap = GAUGE_FRAME_MS * (lvglPassUs > GAUGE_FRAME_BUDGET_US ? 2 : 1);
+  if (now - gauge.stepMs < gap) return;
+  const float dt = (float)min(now - gauge.stepMs, (uint32_t)100);
+  gauge.stepMs = now;
+
+  EcuData ecu;
+  ecuSnapshot(ecu);
+  gauge_sample(ecu);
+  const float ahead = linkValid ? (float)min(now - gauge.sampleMs, GAUGE_EXTRAP_MAX_MS) : 0.0f;
+  const float target = clampf(gauge.sample + gauge.slope * ahead, 0, (float)RPM_MAX);
+
+  if (setting_gaugeSmoothMs == 0) {
+    gauge.x = target;
+    gauge.v = 0;
+  } else {
+    // x'' = w^2 (target - x) - 2 w x', semi-implicit Euler in sub-steps of at most 0.5 / w.
+    const float w = 1.0f / (float)setting_gaugeSmoothMs;
+    const int n = max(1, (int)ceilf(dt * w * 2.0f));
+    const float h = dt / (float)n;
+    for (int i = 0; i < n; i++) {
+      gauge.v += (w * w * (target - gauge.x) - 2.0f * w * gauge.v) * h;
+      gauge.x += gauge.v * h;
+    }
+  }
+
+  if (gauge.drawn >= 0 && fabsf(gauge.x - gauge.drawn) < GAUGE_MIN_STEP_RPM) return;
+  gauge.drawn = gauge.x;
+  const int rpm = (int)lroundf(gauge.x);
+  set_ring_rpm(rpm);
+  update_bar_fill(rpm);
+}
+
+static void build_dash() {
+  scr_dash = lv_obj_create(NULL);
+  lv_obj_set_style_bg_color(scr_dash, lvcol(C_BG), 0);
+  lv_obj_clear_flag(scr_dash, LV_OBJ_FLAG_SCROLLABLE);
 
-  ui_afr    = make_tile(scr_dash, 0,0, "AFR",  "",   C_YELL);
-  ui_vbat   = make_tile(scr_dash, 0,0, "VBAT", "V",  C_GREEN);
-  ui_iat    = make_tile(scr_dash, 0,0, "IAT",  "C",  C_AMBER);
-  ui_clt    = make_tile(scr_dash, 0,0, "CLT",  "C",  C_AMBER);
-  ui_tps    = make_tile(scr_dash, 0,0, "TPS",  "%",  C_GREEN);
-  ui_adv    = make_tile(scr_dash, 0,0, "ADV",  "deg",C_YELL);
-  ui_warm   = make_tile(scr_dash, 0,0, "WARMUP","",  C_AMBER);
-  ui_launch = make_tile(scr_dash, 0,0, "LAUNCH","",  C_RED);
+  build_status_bar(scr_dash);
 
-  build_bar_view(scr_dash);
+  cont_view = lv_obj_create(scr_dash);
+  lv_obj_set_pos(cont_view, 0, 0);
+  lv_obj_set_size(cont_view, SCREEN_W, SCREEN_H);
+  lv_obj_set_style_bg_opa(cont_view, LV_OPA_TRANSP, 0);
+  lv_obj_set_style_border_width(cont_view, 0, 0);
+  lv_obj_set_style_radius(cont_view, 0, 0);
+  lv_obj_set_style_pad_all(cont_view, 0, 0);
+  lv_obj_clear_flag(cont_view, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_clear_flag(cont_view, LV_OBJ_FLAG_CLICKABLE);
+
+  // Extra pages are built into this on first visit (see show_page()), under the buttons.
+  cont_pages = lv_obj_create(scr_dash);
+  lv_obj_set_pos(cont_pages, 0, 0);
+  lv_obj_set_size(cont_pages, SCREEN_W, SCREEN_H);
+  lv_obj_set_style_bg_opa(cont_pages, LV_OPA_TRANSP, 0);
+  lv_obj_set_style_border_width(cont_pages, 0, 0);
+  lv_obj_set_style_radius(cont_pages, 0, 0);
+  lv_obj_set_style_pad_all(cont_pages, 0, 0);
+  lv_obj_clear_flag(cont_pages, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_clear_flag(cont_pages, LV_OBJ_FLAG_CLICKABLE);
+  lv_obj_add_event_cb(scr_dash, dash_gesture_cb, LV_EVENT_GESTURE, NULL);
 
   btn_rec = lv_btn_create(scr_dash);
   lv_obj_set_size(btn_rec, 90, 32);
@@ -1244,6 +3952,16 @@ lbl_rpm = lv_label_create(scr_dash);
   lv_obj_set_style_text_color(lbl_shift, lv_color_black(), 0);
   lv_obj_center(lbl_shift);
 
+  lbl_stats = lv_label_create(scr_dash);
+  lv_label_set_text(lbl_stats, "");
+  lv_obj_set_style_text_font(lbl_stats, &lv_font_montserrat_12, 0);
+  lv_obj_set_style_text_color(lbl_stats, lv_color_white(), 0);
+  lv_obj_set_style_bg_color(lbl_stats, lv_color_black(), 0);
+  lv_obj_set_style_bg_opa(lbl_stats, LV_OPA_70, 0);
+  lv_obj_set_style_pad_all(lbl_stats, 4, 0);
+  lv_obj_align(lbl_stats, LV_ALIGN_TOP_RIGHT, -4, STATUS_H + 4);
+  apply_stats_overlay();
+
   apply_view_layout();
 }
 
@@ -1459,7 +4177,8 @@ static void refresh_settings_list() {
   {
     const int idx = W_COUNT + 2;
     create_settings_row(list_settings, idx, "LOGGING");
-    lv_label_set_text(settings_val_lbl[idx], "SD log");
+    static const char* const FMT_LABELS[LOG_FMT_COUNT] = { "SD log CSV", "SD log BIN", "SD log DELTA" };
+    lv_label_set_text(settings_val_lbl[idx], FMT_LABELS[setting_logFmt < LOG_FMT_COUNT ? setting_logFmt : 0]);
 
     if (setting_logEnabled) lv_obj_add_state(settings_sw[idx], LV_STATE_CHECKED);
     else                    lv_obj_clear_state(settings_sw[idx], LV_STATE_CHECKED);
@@ -1470,41 +4189,116 @@ static void refresh_settings_list() {
 }
 
 // ============================= UI update =============================
-static void update_status_bar(bool stale) {
+static void apply_stats_overlay() {
+  if (!lbl_stats) return;
+#if USE_PHASE_STATS
+  if (setting_statsOverlay) { lv_obj_clear_flag(lbl_stats, LV_OBJ_FLAG_HIDDEN); return; }
+#endif
+  lv_obj_add_flag(lbl_stats, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void update_stats_overlay() {
+#if USE_PHASE_STATS
+  if (!lbl_stats || !setting_statsOverlay) return;
+  static char txt[PH_COUNT * 40 + 32];
+  int n = snprintf(txt, sizeof(txt), "us     avg  p99  max");
+  for (int i = 0; i < PH_COUNT && n < (int)sizeof(txt); i++) {
+    const PhaseSummary s = phaseOut[i];
+    n += snprintf(txt + n, sizeof(txt) - n, "\n%-6s %4lu %4lu %4lu", PHASE_NAMES[i],
+                  (unsigned long)s.avgUs, (unsigned long)s.p99Us, (unsigned long)s.maxUs);
+  }
+  lv_label_set_text(lbl_stats, txt);
+#endif
+}
+
+static void update_status_bar(bool stale, const EcuData& ecu) {
   lv_obj_t* bar = lv_obj_get_parent(lbl_link);
   if (stale) {
     lv_obj_set_style_bg_color(bar, lv_color_make(120, 0, 0), 0);
     lv_label_set_text(lbl_link, "LINK: STALE");
+#if USE_REPLAY
+  } else if (replayActive) {
+    lv_obj_set_style_bg_color(bar, lv_color_make(0, 40, 120), 0);
+    lv_label_set_text(lbl_link, "REPLAY");
+#endif
   } else {
     lv_obj_set_style_bg_color(bar, lv_color_make(0, 80, 0), 0);
+#if USE_CAN
+    const uint32_t now = millis();
+    const bool ser = srcFresh(ecu, SRC_SERIAL, now), can = srcFresh(ecu, SRC_CAN, now);
+    lv_label_set_text(lbl_link, can ? (ser ? "LINK: OK+CAN" : "LINK: CAN") : "LINK: OK");
+#else
     lv_label_set_text(lbl_link, "LINK: OK");
+#endif
   }
 
   static char b1[24], b2[24];
   snprintf(b1, sizeof(b1), "RX:%lu", (unsigned long)rxBytes);
-  snprintf(b2, sizeof(b2), "Age:%lums", (unsigned long)(millis() - lastRxMs));
+  const uint32_t age = ecuAgeMs(ecu, millis());
+  if (age == UINT32_MAX) snprintf(b2, sizeof(b2), "Age:--");
+  else                   snprintf(b2, sizeof(b2), "Age:%lums", (unsigned long)age);
   lv_label_set_text(lbl_rx, b1);
   lv_label_set_text(lbl_age, b2);
 
+  // min/avg/max over the last RTT_WINDOW_MS
+  static char b4[24];
+  if (rttStatN) snprintf(b4, sizeof(b4), "RTT:%lu/%lu/%lu", (unsigned long)rttStatMinMs,
+                         (unsigned long)rttStatAvgMs, (unsigned long)rttStatMaxMs);
+  else          snprintf(b4, sizeof(b4), "RTT:--");
+  lv_label_set_text(lbl_rtt, b4);
+
+  update_stats_overlay();
+
 #if USE_SD
   lv_label_set_text(lbl_sd, sdOk ? "SD:OK" : "SD:NO");
   lv_label_set_text(lbl_rec, recording ? "REC" : "   ");
+  // Every-frame logging: frames dropped because logTask fell behind (reset on REC start)
+  static char b3[16];
+  const uint32_t drops = logQueueDrops;
+  if (drops) snprintf(b3, sizeof(b3), "Q:%lu", (unsigned long)drops);
+  else       b3[0] = 0;
+  lv_label_set_text(lbl_logq, b3);
 #else
   lv_label_set_text(lbl_sd, "SD:--");
 #endif
 }
 
+// Visible extra page only, with the same change tracking as the main tiles.
+static void update_page_values(const EcuData& ecu, ChMask fresh) {
+  PageUI& pg = pageUi[curPage - 1];
+  const PageDef& def = PAGES[curPage - 1];
+  if (!pg.cont) return;
+  if (!linkValid) {
+    for (int i = 0; i < def.count; i++) set_tile_blank(pg.tiles[i]);
+    page_invalidate(pg);
+    return;
+  }
+  for (int i = 0; i < def.count; i++) {
+    if (!(fresh & chBit(def.tiles[i].ch))) { set_tile_blank(pg.tiles[i]); pg.prev[i] = INT32_MIN; continue; }
+    const int32_t fx = chFixed(ecu, def.tiles[i].ch);
+    if (fx == pg.prev[i] && !((ecu.warn ^ pg.prevWarn) & warnBitsFor(def.tiles[i].ch))) continue;
+    pg.prev[i] = fx;
+    tile_show(pg.tiles[i], def.tiles[i], ecu);
+  }
+  pg.prevWarn = ecu.warn;
+}
+
 static void update_dash_values() {
-  bool stale = (millis() - lastRxMs) > LINK_STALE_MS;
+  EcuData ecu;
+  ecuSnapshot(ecu);
+  const ChMask fresh = ecuFreshMask(ecu, millis());
+  const bool stale = fresh == 0;
   if (stale) linkValid = false;
 
   static uint32_t lastStatus = 0;
   if (millis() - lastStatus > STATUS_UPDATE_MS) {
-    update_status_bar(stale);
+    update_status_bar(stale, ecu);
     lastStatus = millis();
   }
+  ring_face_refresh();
 
-  if (setting_shiftEnabled && linkValid && ecu.rpm >= setting_shiftRpm) {
+  const int rpm = (fresh & chBit(CH_RPM)) ? chInt(ecu, CH_RPM) : 0;
+  if (setting_shiftEnabled && linkValid && rpm >= setting_shiftRpm) {
     if (!shiftActive) {
       shiftActive = true;
       shiftBlinkT0 = millis();
@@ -1526,91 +4320,122 @@ static void update_dash_values() {
     }
   }
 
+  if (curPage != 0) { update_page_values(ecu, fresh); return; }
+
   if (!linkValid) {
-    for (int i=0;i<8;i++) set_tile_blank(*tiles_all[i]);
-    lv_label_set_text(lbl_rpm, "0");
-    if (meter_rpm && meter_needle) lv_meter_set_indicator_value(meter_rpm, meter_needle, 0);
-    update_bar_rpm(0);
+    for (int i=0;i<TILE_COUNT;i++) set_tile_blank(*tiles_all[i]);
+    if (lbl_rpm) lv_label_set_text(lbl_rpm, "0");
+    update_bar_label(0);
     prev = PrevData();
     prev.rpm = 0;
     return;
   }
 
-  if (ecu.rpm != prev.rpm) {
+  if (rpm != prev.rpm) {
     char buf[12];
-    snprintf(buf, sizeof(buf), "%d", ecu.rpm);
-    lv_label_set_text(lbl_rpm, buf);
-    if (meter_rpm && meter_needle) lv_meter_set_indicator_value(meter_rpm, meter_needle, ecu.rpm);
-    update_bar_rpm(ecu.rpm);
-    prev.rpm = ecu.rpm;
-  }
-
-  int afr100 = (int)lroundf(ecu.afr * 100.0f);
-  if (afr100 != prev.afrScaled) {
-    bool warn = warnCheckFloat(W_AFR, ecu.afr);
-    char buf[16];
-    snprintf(buf, sizeof(buf), "%.2f", ecu.afr);
-    int bar = (int)(clampf((ecu.afr - 9.0f) / (20.0f - 9.0f), 0, 1) * 1000);
-    set_tile_value(ui_afr, buf, bar, warn);
-    prev.afrScaled = afr100;
+    snprintf(buf, sizeof(buf), "%d", rpm);
+    if (lbl_rpm) lv_label_set_text(lbl_rpm, buf);
+    update_bar_label(rpm);
+    prev.rpm = rpm;
   }
 
-  int vbat10 = (int)lroundf(ecu.vbat * 10.0f);
-  if (vbat10 != prev.vbat10) {
-    bool warn = warnCheckFloat(W_VBAT, ecu.vbat);
-    char buf[16];
-    snprintf(buf, sizeof(buf), "%.1f", ecu.vbat);
-    int bar = (int)(clampf((ecu.vbat - 10.0f) / (15.5f - 10.0f), 0, 1) * 1000);
-    set_tile_value(ui_vbat, buf, bar, warn);
-    prev.vbat10 = vbat10;
-  }
-
-  if (ecu.iatC != prev.iatC) {
-    bool warn = warnCheckInt(W_IAT, ecu.iatC);
-    char buf[16];
-    snprintf(buf, sizeof(buf), "%d", ecu.iatC);
-    int bar = (int)(clampf(((float)ecu.iatC - -20.0f) / (80.0f - -20.0f), 0, 1) * 1000);
-    set_tile_value(ui_iat, buf, bar, warn);
-    prev.iatC = ecu.iatC;
+  for (int i = 0; i < TILE_COUNT; i++) {
+    const TileDef& def = TILE_DEFS[i];
+    if (!(fresh & chBit(def.ch))) { set_tile_blank(*tiles_all[i]); prev.tile[i] = INT32_MIN; continue; }
+    const int32_t fx = chFixed(ecu, def.ch);
+    if (fx == prev.tile[i] && !((ecu.warn ^ prev.warn) & warnBitsFor(def.ch))) continue;
+    prev.tile[i] = fx;
+    tile_show(*tiles_all[i], def, ecu);
   }
+  prev.warn = ecu.warn;
+}
 
-  if (ecu.cltC != prev.cltC) {
-    bool warn = warnCheckInt(W_CLT, ecu.cltC);
-    char buf[16];
-    snprintf(buf, sizeof(buf), "%d", ecu.cltC);
-    int bar = (int)(clampf(((float)ecu.cltC - 0.0f) / (120.0f - 0.0f), 0, 1) * 1000);
-    set_tile_value(ui_clt, buf, bar, warn);
-    prev.cltC = ecu.cltC;
+// ============================= Benchmarks =============================
+#if USE_BENCH
+// /bench?run=1 posts UI_REQ_BENCH and the render task runs every case back to back (the dash
+// stalls for a fraction of a second); GET /bench returns the last result. The codec cases
+// start from the current snapshot, so they follow whatever the ECU or a replay is sending.
+// Codec times are ns per frame over BENCH_ITERS; tiles is one pass over every tile (labels,
+// bars and the warn restyle, no drawing); render is a full-screen invalidate + lv_refr_now(),
+// flush included, averaged over BENCH_RENDERS.
+static const uint32_t BENCH_ITERS = 1000;
+static const uint32_t BENCH_TILE_PASSES = 50;
+static const uint32_t BENCH_RENDERS = 5;
+
+struct BenchResult {
+  uint32_t runMs;                   // 0: never run
+  uint32_t decodeNs;                // decodeAllChannels()
+  uint32_t csvNs, binNs, deltaNs;   // one log record (delta: pack + binDeltaEncode)
+  uint32_t tilesUs;
+  uint32_t renderUs;
+};
+static BenchResult benchLast;       // render task writes; /bench may read a torn result mid-run
+static volatile int32_t benchSink;  // keeps the measured loops from being optimised away
+
+static void benchRun() {
+  BenchResult r{};
+  EcuData ecu;
+  ecuSnapshot(ecu);
+
+  uint8_t p[CH_FRAME_LEN];
+  encodeAllChannels(ecu.raw, p);
+  int32_t out[CH_COUNT];
+  uint32_t t0 = micros();
+  for (uint32_t i = 0; i < BENCH_ITERS; i++) {
+    p[CHANNELS[CH_RPM].offset] = (uint8_t)i;
+    decodeAllChannels(p, CH_FRAME_LEN, out);
+    benchSink = out[CH_RPM];
   }
+  r.decodeNs = (micros() - t0) * 1000 / BENCH_ITERS;
 
-  if (ecu.tps != prev.tps) {
-    bool warn = warnCheckInt(W_TPS, ecu.tps);
-    char buf[16];
-    snprintf(buf, sizeof(buf), "%d", ecu.tps);
-    int bar = (int)(clampf((float)ecu.tps / 100.0f, 0, 1) * 1000);
-    set_tile_value(ui_tps, buf, bar, warn);
-    prev.tps = ecu.tps;
+#if USE_SD
+  char line[CSV_LINE_MAX];
+  t0 = micros();
+  for (uint32_t i = 0; i < BENCH_ITERS; i++) benchSink = (int32_t)csvFormatSample(ecu, i, line);
+  r.csvNs = (micros() - t0) * 1000 / BENCH_ITERS;
+
+  uint8_t rec[BIN_LOG_RECORD_SIZE], prevRec[BIN_LOG_RECORD_SIZE], delta[BIN_DELTA_MAX];
+  t0 = micros();
+  for (uint32_t i = 0; i < BENCH_ITERS; i++) { binLogPack(ecu, i, rec); benchSink = rec[4]; }
+  r.binNs = (micros() - t0) * 1000 / BENCH_ITERS;
+
+  binLogPack(ecu, 0, prevRec);
+  EcuData e = ecu;
+  t0 = micros();
+  for (uint32_t i = 0; i < BENCH_ITERS; i++) {
+    e.raw[CH_RPM] = ecu.raw[CH_RPM] + (int32_t)(i & 15);
+    binLogPack(e, i, rec);
+    benchSink = (int32_t)binDeltaEncode(rec, prevRec, 10, delta);
   }
+  r.deltaNs = (micros() - t0) * 1000 / BENCH_ITERS;
+#endif
 
-  if (ecu.advance != prev.advance) {
-    bool warn = warnCheckInt(W_ADV, ecu.advance);
-    char buf[16];
-    snprintf(buf, sizeof(buf), "%d", ecu.advance);
-    int bar = (int)(clampf(((float)ecu.advance - -10.0f) / (50.0f - -10.0f), 0, 1) * 1000);
-    set_tile_value(ui_adv, buf, bar, warn);
-    prev.advance = ecu.advance;
+  if (tiles_all[0]->lbl_value) {
+    t0 = micros();
+    for (uint32_t i = 0; i < BENCH_TILE_PASSES; i++) {
+      char buf[12];
+      snprintf(buf, sizeof(buf), "%lu", (unsigned long)i);
+      for (int k = 0; k < TILE_COUNT; k++) set_tile_value(*tiles_all[k], buf, (int)(i * 20 % 1000), (i & 8) != 0);
+    }
+    r.tilesUs = (micros() - t0) / BENCH_TILE_PASSES;
+    prev = PrevData();   // the next update_dash_values() puts every real value back
   }
 
-  if ((int)ecu.warmup != prev.warmup) {
-    set_tile_value(ui_warm, ecu.warmup ? "ACTIVE" : "----", 0, false, ecu.warmup);
-    prev.warmup = (int)ecu.warmup;
+  lv_obj_t* scr = lv_scr_act();
+  t0 = micros();
+  for (uint32_t i = 0; i < BENCH_RENDERS; i++) {
+    lv_obj_invalidate(scr);
+    lv_refr_now(NULL);
   }
+  r.renderUs = (micros() - t0) / BENCH_RENDERS;
 
-  if ((int)ecu.launch != prev.launch) {
-    set_tile_value(ui_launch, ecu.launch ? "ACTIVE" : "----", 0, false, ecu.launch);
-    prev.launch = (int)ecu.launch;
-  }
+  r.runMs = millis();
+  benchLast = r;
+  DBG_PRINTF("[BENCH] decode %lu ns, csv %lu ns, bin %lu ns, delta %lu ns, tiles %lu us, render %lu us\n",
+                (unsigned long)r.decodeNs, (unsigned long)r.csvNs, (unsigned long)r.binNs,
+                (unsigned long)r.deltaNs, (unsigned long)r.tilesUs, (unsigned long)r.renderUs);
 }
+#endif
 
 // ============================= LVGL tick helper =============================
 static uint32_t lastTick = 0;
@@ -1621,117 +4446,419 @@ static void lvglTick() {
   lv_tick_inc(diff);
 }
 
-// ============================= PORTAL SCREEN (TFT direct) =============================
-// When a WiFi station connects, we STOP LVGL completely and draw a simple TFT screen.
-// This avoids LVGL + webserver contention and prevents "web pages not loading" freezes.
-static void drawPortalScreen() {
-  tft.fillScreen(TFT_BLACK);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
+// ============================================================================
+// ============================= WIFI WEB PORTAL (LITE) ========================
+// ============================================================================
 
-  tft.setTextSize(2);
-  tft.setCursor(18, 18);
-  tft.print("WEB CONFIGURATION MODE");
+#if USE_WIFI
 
-  tft.setTextSize(1);
-  tft.setCursor(18, 58);
-  tft.print("Connect to WiFi AP:");
+#if USE_SD
+// log_NNNNN may be .csv or .bin depending on the format active when it was recorded.
+static bool findLogByIndex(uint32_t idx, char* out, size_t outSz) {
+  sdLock();
+  snprintf(out, outSz, "/log_%05lu.csv", (unsigned long)idx);
+  bool found = SD.exists(out);
+  if (!found) {
+    snprintf(out, outSz, "/log_%05lu.bin", (unsigned long)idx);
+    found = SD.exists(out);
+  }
+  sdUnlock();
+  return found;
+}
 
-  tft.setTextSize(2);
-  tft.setCursor(18, 78);
-  tft.print(WIFI_AP_SSID);
+static bool sdExists(const char* path) {
+  sdLock();
+  const bool ok = SD.exists(path);
+  sdUnlock();
+  return ok;
+}
 
-  tft.setTextSize(1);
-  tft.setCursor(18, 112);
-  tft.print("Password: ");
-  tft.print(WIFI_AP_PASS);
+// The file being recorded is still growing (and staged), so it is never served.
+static bool isActiveLog(const char* path) {
+  if (!recording && !logClosing) return false;
+  sdLock();
+  const bool active = (recording || logClosing) && (strcmp(path, logFileName) == 0 || strcmp(path, capFileName) == 0);
+  sdUnlock();
+  return active;
+}
 
-  // IP address
-#if USE_WIFI
-  IPAddress ip = WiFi.softAPIP();
-  tft.setCursor(18, 136);
-  tft.print("Open in browser: http://");
-  tft.print(ip[0]); tft.print(".");
-  tft.print(ip[1]); tft.print(".");
-  tft.print(ip[2]); tft.print(".");
-  tft.print(ip[3]);
-#else
-  tft.setCursor(18, 136);
-  tft.print("WiFi disabled in build");
-#endif
+// One SD read under sdMutex; network sends happen outside it.
+static size_t sdRead(File& f, uint8_t* buf, size_t n) {
+  sdLock();
+  const size_t got = f.read(buf, n);
+  sdUnlock();
+  return got;
+}
+
+// ---- Download responses ----
+// Both download kinds are async fillers: the server asks for at most maxLen bytes whenever
+// the socket can take more, so a transfer never holds a task (or sdMutex) while the client
+// is slow. State lives in a shared_ptr owned by the filler; its destructor closes the file,
+// also when the client goes away mid-transfer.
+static const uint8_t BIN_LOG_MAX_CHANNELS = 64;
+
+// Throughput for /stats: bytes handed to the server, and the rate of the last download.
+static const uint32_t DL_STATS_MIN_BYTES = 64 * 1024;   // smaller transfers say little about the link
+static std::atomic<uint32_t> dlBytes{0};
+static std::atomic<uint32_t> dlActive{0};
+static volatile uint32_t dlLastKBps = 0;
+
+struct LogDownload {
+  File f;
+  uint32_t t0 = millis();
+  uint32_t sent = 0;
+  LogDownload() { dlActive++; }
+  ~LogDownload() {
+    sdLock(); if (f) f.close(); sdUnlock();
+    dlActive--;
+    const uint32_t ms = millis() - t0;
+    if (sent >= DL_STATS_MIN_BYTES && ms) dlLastKBps = (uint32_t)((uint64_t)sent * 1000 / 1024 / ms);
+  }
+  void count(size_t n) { sent += n; dlBytes += n; }
+};
 
-  tft.setCursor(18, 160);
-  tft.print("Tip: When connected, dashboard UI is stopped.");
-  tft.setCursor(18, 174);
-  tft.print("Disconnect from AP to return to dashboard.");
+// Raw file bytes [pos, end). The file is read DL_BLOCK at a time at block-aligned offsets,
+// so FATFS moves whole sectors straight into blk and each sdMutex hold covers 16 sectors;
+// fill() then copies out of blk for as many calls as the socket window needs.
+static const size_t DL_BLOCK = 8192;
+
+struct RawDownload : LogDownload {
+  uint8_t* blk = nullptr;      // DL_BLOCK bytes (internal RAM: the SD driver DMAs into it)
+  uint32_t blkOff = 0;         // file offset of blk[0]
+  size_t blkLen = 0;
+  uint32_t pos = 0, end = 0;
+  ~RawDownload() { free(blk); }
+
+  size_t fill(uint8_t* buf, size_t maxLen) {
+    size_t n = 0;
+    while (n < maxLen && pos < end) {
+      if (pos < blkOff || pos >= blkOff + blkLen) {
+        blkOff = pos & ~(uint32_t)(DL_BLOCK - 1);
+        sdLock();
+        blkLen = f.seek(blkOff) ? f.read(blk, DL_BLOCK) : 0;
+        sdUnlock();
+        if (pos >= blkOff + blkLen) break;   // file shrank under us; end the response short
+      }
+      const size_t k = min(min(maxLen - n, (size_t)(blkOff + blkLen - pos)), (size_t)(end - pos));
+      memcpy(buf + n, blk + (pos - blkOff), k);
+      pos += k;
+      n += k;
+    }
+    count(n);
+    return n;
+  }
+};
 
-  tft.setCursor(18, 208);
-  tft.print("FW: ");
-  tft.print(FW_VERSION);
+// Single "bytes=a-b" / "bytes=a-" / "bytes=-n" range. Returns 1 with [a, b] set, 0 to serve
+// the whole file (no header, or a form we don't support such as multiple ranges) and -1
+// when the range can't be satisfied (416).
+static int parseRange(const String& v, uint32_t size, uint32_t& a, uint32_t& b) {
+  if (!v.startsWith("bytes=") || v.indexOf(',') >= 0) return 0;
+  const int dash = v.indexOf('-', 6);
+  if (dash < 0) return 0;
+  const String first = v.substring(6, dash), last = v.substring(dash + 1);
+  if (first.length() == 0) {            // suffix: last n bytes
+    const long n = last.toInt();
+    if (n <= 0 || size == 0) return -1;
+    a = (uint32_t)n >= size ? 0 : size - (uint32_t)n;
+    b = size - 1;
+    return 1;
+  }
+  const long s = first.toInt();
+  const long e = last.length() ? last.toInt() : (long)size - 1;
+  if (s < 0 || (uint32_t)s >= size || e < s) return -1;
+  a = (uint32_t)s;
+  b = min((uint32_t)e, size - 1);
+  return 1;
 }
 
-// Portal mode transition handler (safe to call from wifiLoop)
-static void setPortalMode(bool on) {
-  if (portalMode == on) return;
-  portalMode = on;
+// .bin -> CSV, record by record (no temp file, bounded RAM per download).
+// A delta stream that is entered mid-file or hits a damaged record skips to the next keyframe;
+// more than BIN_RESYNC_MAX bytes without one ends the download.
+static const uint32_t BIN_RESYNC_MAX = 64 * 1024;
+
+struct BinCsvDownload : LogDownload {
+  BinLogHeader h;
+  BinLogChannel ch[BIN_LOG_MAX_CHANNELS];
+  uint8_t blk[2048];          // file bytes, read one block per sdMutex hold
+  size_t blkLen = 0, blkPos = 0;
+  uint32_t blkFileOff = 0;    // file offset of blk[0]
+  uint32_t stopAt = UINT32_MAX;   // Range end: no record starting after this offset
+  uint8_t cur[256];           // delta streams: record rebuilt so far
+  bool haveKey = false;
+  char txt[1460];             // formatted text not yet handed to the server
+  size_t txtLen = 0, txtPos = 0;
+  bool eof = false;
+
+  // Tops blk up so at least `need` bytes follow blkPos (unless the file ends); returns what's there.
+  size_t avail(size_t need) {
+    if (blkLen - blkPos < need && !eof) {
+      memmove(blk, blk + blkPos, blkLen - blkPos);
+      blkLen -= blkPos;
+      blkFileOff += blkPos;
+      blkPos = 0;
+      const size_t want = sizeof(blk) - blkLen;
+      const size_t got = sdRead(f, blk + blkLen, want);
+      blkLen += got;
+      if (got < want) eof = true;
+    }
+    return blkLen - blkPos;
+  }
 
-  if (on) {
-    // Stop ECU serial completely to reduce interrupt/CPU load while serving web pages.
-    // Note: if USE_UART0, this also stops USB serial debug (acceptable in portal mode).
-    ECU_SERIAL.end();
-    delay(20);
-    // Stop SD recording so SD browsing/download doesn't fight SPI or file handle
-#if USE_SD
-    if (recording) stopRecording();
-#endif
-    setUiPaused(true);
+  size_t keySize() const { return sizeof(BIN_KEY_SYNC) + h.recordSize + 4; }
 
-    // Draw the portal screen once (no LVGL needed)
-    drawPortalScreen();
-  } else {
-    // Restart ECU serial
-#if USE_UART0
-    ECU_SERIAL.begin(ECU_BAUD);
-#else
-    ECU_SERIAL.begin(ECU_BAUD, SERIAL_8N1, ECU_RX_PIN, ECU_TX_PIN);
-#endif
-    while (ECU_SERIAL.available()) ECU_SERIAL.read();
-    rxState = WAIT_N;
-    rxCount = 0;
-    rxLen = 0;
-    linkValid = false;
-    lastRxMs = millis();
+  // A keyframe at p (a bytes available): sync, record, CRC32 of the record.
+  bool keyAt(const uint8_t* p, size_t a) const {
+    return a >= keySize() && memcmp(p, BIN_KEY_SYNC, sizeof(BIN_KEY_SYNC)) == 0 &&
+           crc32(p + sizeof(BIN_KEY_SYNC), h.recordSize) == u32le(p + sizeof(BIN_KEY_SYNC) + h.recordSize);
+  }
+
+  // Applies the 'D' record at p to cur; false if it runs past the a bytes available.
+  bool deltaAt(const uint8_t* p, size_t a) {
+    const size_t maskBytes = (h.channelCount - 1 + 7) / 8;
+    if (a < 3 + maskBytes) return false;
+    const uint8_t* end = p + a;
+    const uint8_t* mask = p + 3;
+    const uint8_t* q = mask + maskBytes;
+    binLogPut(cur, ch[0], binLogRead(cur, ch[0]) + (int32_t)(p[1] | (p[2] << 8)));   // column 0 is ms
+    for (uint8_t c = 1; c < h.channelCount; c++) {
+      if (!(mask[(c - 1) >> 3] & (1u << ((c - 1) & 7)))) continue;
+      uint32_t z;
+      const size_t k = varintGet(q, end, z);
+      if (!k) return false;
+      q += k;
+      binLogPut(cur, ch[c], binLogRead(cur, ch[c]) + unzigzag(z));
+    }
+    blkPos = q - blk;
+    return true;
+  }
 
-    setUiPaused(false);
+  // Skips to the next valid keyframe; false at end of file, past stopAt or BIN_RESYNC_MAX.
+  bool resync() {
+    haveKey = false;
+    for (uint32_t skipped = 0; skipped <= BIN_RESYNC_MAX;) {
+      blkPos++;
+      skipped++;
+      const size_t a = avail(keySize());
+      if (a < keySize() || blkFileOff + blkPos > stopAt) return false;
+      const uint8_t* p = blk + blkPos;
+      const uint8_t* hit = (const uint8_t*)memchr(p, BIN_TAG_KEY, a - keySize() + 1);
+      if (!hit) { blkPos += a - keySize(); skipped += a - keySize(); continue; }
+      blkPos += hit - p;
+      skipped += hit - p;
+      if (keyAt(hit, a - (hit - p))) return true;
+    }
+    return false;
+  }
 
-    // Force LVGL to repaint on next dashLoop iteration
-    if (lvReady && scr_dash) {
-      lv_scr_load(scr_dash);
-      lv_obj_invalidate(scr_dash);
+  // Next record, or nullptr at end of file (or of the requested range).
+  const uint8_t* next() {
+    if (h.version < BIN_LOG_VERSION_DELTA) {
+      if (blkFileOff + blkPos > stopAt || avail(h.recordSize) < h.recordSize) return nullptr;
+      const uint8_t* r = blk + blkPos;
+      blkPos += h.recordSize;
+      return r;
+    }
+    const size_t need = max(keySize(), 3 + (h.channelCount - 1 + 7) / 8 + (size_t)(h.channelCount - 1) * 5);
+    for (;;) {
+      const size_t a = avail(need);
+      if (a == 0 || blkFileOff + blkPos > stopAt) return nullptr;
+      const uint8_t* p = blk + blkPos;
+      if (p[0] == BIN_TAG_KEY && keyAt(p, a)) {
+        memcpy(cur, p + sizeof(BIN_KEY_SYNC), h.recordSize);
+        haveKey = true;
+        blkPos += keySize();
+        return cur;
+      }
+      if (p[0] == BIN_TAG_DELTA && haveKey && deltaAt(p, a)) return cur;
+      if (!resync()) return nullptr;
+    }
+  }
+
+  // Refills txt with as many rows as fit; false once the file is exhausted.
+  bool produce() {
+    txtLen = txtPos = 0;
+    // Worst case per channel is ~12 chars; stop well before the buffer can overflow.
+    const size_t rowMax = (size_t)h.channelCount * 13 + 2;
+    while (txtLen + rowMax <= sizeof(txt)) {
+      const uint8_t* rec = next();
+      if (!rec) break;
+      for (uint8_t c = 0; c < h.channelCount; c++) {
+        if (c) txt[txtLen++] = ',';
+        txtLen += formatFixed(txt + txtLen, sizeof(txt) - txtLen, binLogRead(rec, ch[c]) * ch[c].mul + ch[c].bias, ch[c].decimals);
+      }
+      txt[txtLen++] = '\r';
+      txt[txtLen++] = '\n';
+    }
+    return txtLen != 0;
+  }
+
+  size_t fill(uint8_t* buf, size_t maxLen) {
+    size_t n = 0;
+    while (n < maxLen) {
+      if (txtPos == txtLen && !produce()) break;
+      const size_t k = min(maxLen - n, txtLen - txtPos);
+      memcpy(buf + n, txt + txtPos, k);
+      txtPos += k;
+      n += k;
+    }
+    count(n);
+    return n;   // 0 ends the chunked response
+  }
+};
+
+// range > 0: [a, b] are .bin offsets (see sendLogFile()).
+static void sendBinLogAsCsv(AsyncWebServerRequest* req, File& f, const char* path, uint32_t size, int range, uint32_t a, uint32_t b) {
+  std::shared_ptr<BinCsvDownload> d(new (std::nothrow) BinCsvDownload());
+  if (!d) { sdLock(); f.close(); sdUnlock(); req->send(503, "text/plain", "Out of memory"); return; }
+  d->f = f;
+  BinLogHeader& h = d->h;
+  BinLogChannel* ch = d->ch;
+  bool ok = sdRead(d->f, (uint8_t*)&h, sizeof(h)) == sizeof(h) && memcmp(h.magic, "EDLG", 4) == 0 &&
+            h.version >= 1 && h.version <= BIN_LOG_VERSION_DELTA &&
+            h.channelCount != 0 && h.channelCount <= BIN_LOG_MAX_CHANNELS &&
+            h.recordSize != 0 && h.recordSize <= sizeof(d->cur);
+  const size_t entrySz = (h.version == 1) ? BIN_LOG_CHANNEL_V1_SIZE : sizeof(BinLogChannel);
+  for (uint8_t c = 0; ok && c < h.channelCount; c++) {
+    ch[c] = BinLogChannel{};
+    ch[c].mul = 1;
+    ok = sdRead(d->f, (uint8_t*)&ch[c], entrySz) == entrySz;
+  }
+  if (!ok) {
+    req->send(415, "text/plain", "Not an ESP Dash binary log");
+    return;
+  }
+  for (uint8_t c = 0; c < h.channelCount; c++) {
+    if (ch[c].type > CT_BIT || (uint32_t)ch[c].offset + chWidth(ch[c].type) > h.recordSize) {
+      req->send(415, "text/plain", "Bad channel table"); return;
     }
   }
+
+  // A range starts at the first whole record (v1/v2) or keyframe (v3) at or after a.
+  const uint32_t body = sizeof(h) + h.channelCount * entrySz;
+  d->blkFileOff = body;
+  if (range > 0) {
+    uint32_t from = max(a, body);
+    if (h.version < BIN_LOG_VERSION_DELTA) from = body + (from - body + h.recordSize - 1) / h.recordSize * h.recordSize;
+    sdLock();
+    const bool sought = d->f.seek(from);
+    sdUnlock();
+    if (!sought) { req->send(416, "text/plain", "Range not satisfiable"); return; }
+    d->blkFileOff = from;
+    d->haveKey = false;
+    d->stopAt = b;
+  }
+
+  // Header row goes out first, then produce() takes over.
+  for (uint8_t c = 0; c < h.channelCount; c++) {
+    char nm[sizeof(ch[c].name) + 1];
+    memcpy(nm, ch[c].name, sizeof(ch[c].name));
+    nm[sizeof(ch[c].name)] = 0;
+    d->txtLen += snprintf(d->txt + d->txtLen, sizeof(d->txt) - d->txtLen, "%s%s", c ? "," : "", nm);
+  }
+  d->txtLen += snprintf(d->txt + d->txtLen, sizeof(d->txt) - d->txtLen, "\r\n");
+
+  // "/log_00001.bin" -> "log_00001.csv"
+  String csvName = String(path[0] == '/' ? path + 1 : path);
+  csvName = csvName.substring(0, csvName.length() - 3) + "csv";
+  AsyncWebServerResponse* res = req->beginChunkedResponse("text/csv", [d](uint8_t* buf, size_t maxLen, size_t) -> size_t {
+    PHASE_SCOPE(PH_HTTP);
+    return d->fill(buf, maxLen);
+  });
+  if (range > 0) {
+    char cr[48];
+    snprintf(cr, sizeof(cr), "bytes %lu-%lu/%lu", (unsigned long)a, (unsigned long)b, (unsigned long)size);
+    res->setCode(206);
+    res->addHeader("Content-Range", cr);   // of the .bin: the CSV of the records in that span
+  }
+  res->addHeader("Content-Disposition", "attachment; filename=\"" + csvName + "\"");
+  // No validator, so browsers never resume this: a CSV offset is not a .bin offset.
+  res->addHeader("Accept-Ranges", "none");
+  req->send(res);
 }
 
-// ============================================================================
-// ============================= WIFI WEB PORTAL (LITE) ========================
-// ============================================================================
+// .csv is streamed as-is; .bin is converted to CSV unless ?raw=1. A Range on a converted .bin
+// selects bytes of the .bin: the reply is the CSV of the records in that span (206), decoded
+// from the first keyframe in it, so a tool can fetch any part of a long log.
+static void sendLogFile(AsyncWebServerRequest* req, const char* path) {
+  if (isActiveLog(path)) { req->send(409, "text/plain", "Log is being recorded"); return; }
+  sdLock();
+  File f = SD.open(path, FILE_READ);
+  const size_t size = f ? f.size() : 0;
+  sdUnlock();
+  if(!f){ req->send(404, "text/plain", "Not found"); return; }
+
+  const bool raw = req->hasArg("raw") && req->arg("raw") == "1";
+  if (endsWithBin(path) && !raw) {
+    uint32_t a = 0, b = 0;
+    const int range = req->hasHeader("Range") ? parseRange(req->getHeader("Range")->value(), size, a, b) : 0;
+    if (range < 0) {
+      sdLock(); f.close(); sdUnlock();
+      AsyncWebServerResponse* res = req->beginResponse(416);
+      res->addHeader("Content-Range", String("bytes */") + size);
+      req->send(res);
+      return;
+    }
+    sendBinLogAsCsv(req, f, path, size, range, a, b);
+    return;
+  }
 
-#if USE_WIFI
+  // Closed logs never change in place, so the size is enough of a validator for If-Range.
+  char etag[16];
+  snprintf(etag, sizeof(etag), "\"%lx\"", (unsigned long)size);
+  uint32_t a = 0, b = size ? size - 1 : 0;
+  int range = 0;
+  if (req->hasHeader("Range") && (!req->hasHeader("If-Range") || req->getHeader("If-Range")->value() == etag))
+    range = parseRange(req->getHeader("Range")->value(), size, a, b);
+  if (range < 0) {
+    sdLock(); f.close(); sdUnlock();
+    AsyncWebServerResponse* res = req->beginResponse(416);
+    res->addHeader("Content-Range", String("bytes */") + size);
+    req->send(res);
+    return;
+  }
 
-// ---- tiny helpers ----
-static bool endsWithCsv(const char* name) {
-  if (!name) return false;
-  size_t n = strlen(name);
-  if (n < 4) return false;
-  return (name[n-4] == '.' && (name[n-3] | 0x20) == 'c' && (name[n-2] | 0x20) == 's' && (name[n-1] | 0x20) == 'v');
+  std::shared_ptr<RawDownload> d = std::make_shared<RawDownload>();
+  d->f = f;
+  d->blk = (uint8_t*)heap_caps_malloc(DL_BLOCK, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!d->blk) { req->send(503, "text/plain", "Out of memory"); return; }
+  d->pos = a;
+  d->end = size ? b + 1 : 0;
+
+  // Length is known up front, so this goes out with Content-Length rather than chunked.
+  const char* name = (path[0] == '/') ? path + 1 : path;
+  AsyncWebServerResponse* res = req->beginResponse(endsWithBin(path) ? "application/octet-stream" : "text/csv", d->end - a,
+                                                   [d](uint8_t* buf, size_t maxLen, size_t) -> size_t {
+    PHASE_SCOPE(PH_HTTP);
+    return d->fill(buf, maxLen);
+  });
+  if (range > 0) {
+    char cr[48];
+    snprintf(cr, sizeof(cr), "bytes %lu-%lu/%lu", (unsigned long)a, (unsigned long)b, (unsigned long)size);
+    res->setCode(206);
+    res->addHeader("Content-Range", cr);
+  }
+  res->addHeader("Accept-Ranges", "bytes");
+  res->addHeader("ETag", etag);
+  res->addHeader("Content-Disposition", String("attachment; filename=\"") + name + "\"");
+  req->send(res);
+}
+#endif
+
+// 303 so the browser re-GETs the target after a POST.
+static void sendRedirect(AsyncWebServerRequest* req, const char* location) {
+  AsyncWebServerResponse* res = req->beginResponse(303);
+  res->addHeader("Location", location);
+  req->send(res);
 }
 
-static void sendHtmlHeaderLite(const char* title) {
-  server.sendContent(F("<!doctype html><html><head><meta name='viewport' content='width=device-width,initial-scale=1'>"));
-  server.sendContent(F("<title>"));
-  server.sendContent(title);
-  server.sendContent(F("</title>"));
+static void sendHtmlHeaderLite(Print* out, const char* title) {
+  out->print(F("<!doctype html><html><head><meta name='viewport' content='width=device-width,initial-scale=1'>"));
+  out->print(F("<title>"));
+  out->print(title);
+  out->print(F("</title>"));
   // Minimal CSS (small + fast)
-  server.sendContent(F("<style>"
+  out->print(F("<style>"
                        "body{font-family:Arial;margin:12px;background:#111;color:#eee;max-width:820px}"
                        "a{color:#7af}small{color:#aaa}"
                        ".card{border:1px solid #333;border-radius:12px;padding:12px;margin:12px 0;background:#1b1b1b}"
@@ -1744,44 +4871,51 @@ static void sendHtmlHeaderLite(const char* title) {
                        "td,th{padding:6px;border-bottom:1px solid #333;text-align:left}"
                        ".ok{color:#3f3}.bad{color:#f66}"
                        "</style></head><body>"));
-  server.sendContent(F("<header><h2>ESP Dash <small>"));
-  server.sendContent(FW_VERSION);
-  server.sendContent(F("</small></h2></header>"));
+  out->print(F("<header><h2>ESP Dash <small>"));
+  out->print(FW_VERSION);
+  out->print(F("</small></h2></header>"));
 }
 
-static void sendHtmlFooterLite() {
-  server.sendContent(F("</body></html>"));
+static void sendHtmlFooterLite(Print* out) {
+  out->print(F("</body></html>"));
 }
 
 // Root: live + GENERAL settings only (small + stable)
-static void handleRoot() {
-#if USE_SD
-  portalBusy = true;
-  if (recording && logFile) logFile.flush();
-#endif
+static void handleRoot(AsyncWebServerRequest* req) {
+  PHASE_SCOPE(PH_HTTP);
 
-  const bool saved = server.hasArg("saved") && server.arg("saved") == "1";
+  const bool saved = req->hasArg("saved") && req->arg("saved") == "1";
 
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.sendHeader("Connection", "close");
-  server.send(200, "text/html", "");
-  sendHtmlHeaderLite("ESP Dash");
+  AsyncResponseStream* out = req->beginResponseStream("text/html");
+  sendHtmlHeaderLite(out, "ESP Dash");
 
   if (saved) {
-    server.sendContent(F("<div class='card ok'><b>Saved!</b> Settings written to ESP32.</div>"));
+    out->print(F("<div class='card ok'><b>Saved!</b> Settings written to ESP32.</div>"));
   }
   // Config-only portal: no live data rendered to reduce CPU/heap.
 
-  server.sendContent(F("<div class='card'>"
+  out->print(F("<div class='card'>"
                        "<b>Portal</b><br>"
                        "<a href='/'>Home</a> &nbsp;|&nbsp; "
                        "<a href='/warn'>Warnings</a> &nbsp;|&nbsp; "
                        "<a href='/logs'>SD Logs</a> &nbsp;|&nbsp; "
+                       "<a href='/view'>Live</a> &nbsp;|&nbsp; "
                        "<a href='/reboot' onclick=\"return confirm('Reboot ESP32?')\">Reboot</a>"
                        "</div>"));
 
+  // Live link counters (acqTask keeps polling while the portal is open)
+  char linkBuf[320];
+  snprintf(linkBuf, sizeof(linkBuf),
+           "<div class='card'><h3>ECU Link</h3><p>Protocol: %s<br>Frames OK: %lu<br>CRC errors: %lu<br>"
+           "Bad frames: %lu<br>Retries: %lu<br>Rate: %lu Hz<br>RTT min/avg/max: %lu / %lu / %lu ms</p></div>",
+           ecuProto == PROTO_R ? "CRC 'r'" : "Legacy 'n'", (unsigned long)ecuFramesOk,
+           (unsigned long)ecuCrcErrors, (unsigned long)ecuBadFrames, (unsigned long)ecuRetries,
+           (unsigned long)rttStatN, (unsigned long)rttStatMinMs, (unsigned long)rttStatAvgMs,
+           (unsigned long)rttStatMaxMs);
+  out->print(linkBuf);
+
   // Logs (no directory listing: stable + low RAM)
-  server.sendContent(F("<div class='card'><h3>Logs</h3>"
+  out->print(F("<div class='card'><h3>Logs</h3>"
                        "<p>Download a log by number (matches <code>log_00001.csv</code>).</p>"
                        "<form method='GET' action='/download'>"
                        "<div class='row'>"
@@ -1792,60 +4926,129 @@ static void handleRoot() {
                        "</div>"));
 
   // General settings form (small)
-  server.sendContent(F("<div class='card'><form method='POST' action='/save'>"
+  out->print(F("<div class='card'><form method='POST' action='/save'>"
                        "<h3>General</h3><div class='row'>"));
 
-  server.sendContent(F("<div><label>View</label><select name='view'>"));
-  server.sendContent(setting_viewMode==0 ? F("<option value='0' selected>Ring</option><option value='1'>Bar</option>")
+  out->print(F("<div><label>View</label><select name='view'>"));
+  out->print(setting_viewMode==0 ? F("<option value='0' selected>Ring</option><option value='1'>Bar</option>")
                                          : F("<option value='0'>Ring</option><option value='1' selected>Bar</option>"));
-  server.sendContent(F("</select></div>"));
+  out->print(F("</select></div>"));
 
-  server.sendContent(F("<div><label>Logging</label><select name='logEn'>"));
-  server.sendContent(!setting_logEnabled ? F("<option value='0' selected>Off</option><option value='1'>On</option>")
+  out->print(F("<div><label>Logging</label><select name='logEn'>"));
+  out->print(!setting_logEnabled ? F("<option value='0' selected>Off</option><option value='1'>On</option>")
                                          : F("<option value='0'>Off</option><option value='1' selected>On</option>"));
-  server.sendContent(F("</select></div>"));
+  out->print(F("</select></div>"));
+
+  out->print(F("<div><label>Log Format</label><select name='logFmt'>"));
+  out->print(setting_logFmt == LOG_FMT_CSV ? F("<option value='0' selected>CSV</option>") : F("<option value='0'>CSV</option>"));
+  out->print(setting_logFmt == LOG_FMT_BIN ? F("<option value='1' selected>Binary</option>") : F("<option value='1'>Binary</option>"));
+  out->print(setting_logFmt == LOG_FMT_BIN_DELTA ? F("<option value='2' selected>Binary, delta-coded</option>")
+                                                 : F("<option value='2'>Binary, delta-coded</option>"));
+  out->print(F("</select></div>"));
+
+  out->print(F("<div><label>Log Rate</label><select name='logAll'>"));
+  out->print(!setting_logEveryFrame ? F("<option value='0' selected>Every 100 ms</option><option value='1'>Every ECU frame</option>")
+                                            : F("<option value='0'>Every 100 ms</option><option value='1' selected>Every ECU frame</option>"));
+  out->print(F("</select></div>"));
+
+  out->print(F("<div><label>Power Governor (clock / refresh follow engine activity)</label><select name='gov'>"));
+  out->print(!setting_govEnabled ? F("<option value='0' selected>Off</option><option value='1'>On</option>")
+                                 : F("<option value='0'>Off</option><option value='1' selected>On</option>"));
+  out->print(F("</select></div>"));
+
+  out->print(F("<div><label>Debug Overlay</label><select name='dbgOv'>"));
+  out->print(!setting_statsOverlay ? F("<option value='0' selected>Off</option><option value='1'>On</option>")
+                                           : F("<option value='0'>Off</option><option value='1' selected>On</option>"));
+  out->print(F("</select></div>"));
+
+  out->print(F("<div><label>ECU Protocol</label><select name='proto'>"));
+  out->print(setting_ecuProto != PROTO_R ? F("<option value='0' selected>Legacy 'n'</option><option value='1'>CRC 'r'</option>")
+                                                 : F("<option value='0'>Legacy 'n'</option><option value='1' selected>CRC 'r'</option>"));
+  out->print(F("</select></div>"));
+
+#if USE_CAN
+  out->print(F("<div><label>ECU Input</label><select name='ecuIn'>"));
+  out->print(setting_ecuInput == IN_SERIAL ? F("<option value='0' selected>Serial</option>") : F("<option value='0'>Serial</option>"));
+  out->print(setting_ecuInput == IN_SERIAL_CAN ? F("<option value='1' selected>Serial + CAN broadcast</option>")
+                                               : F("<option value='1'>Serial + CAN broadcast</option>"));
+  out->print(setting_ecuInput == IN_CAN ? F("<option value='2' selected>CAN broadcast only</option>")
+                                        : F("<option value='2'>CAN broadcast only</option>"));
+  out->print(F("</select></div>"));
+
+  out->print(F("<div><label>CAN Wideband (AEM X-Series, drives AFR)</label><select name='canWbo'>"));
+  out->print(!setting_canWbo ? F("<option value='0' selected>Off</option><option value='1'>On</option>")
+                             : F("<option value='0'>Off</option><option value='1' selected>On</option>"));
+  out->print(F("</select></div>"));
+#endif
 
-  server.sendContent(F("<div><label>Shift Enable</label><select name='shiftEn'>"));
-  server.sendContent(!setting_shiftEnabled ? F("<option value='0' selected>Off</option><option value='1'>On</option>")
+  out->print(F("<div><label>Black Box Auto-REC (warning / shift light)</label><select name='bbAuto'>"));
+  out->print(!setting_bbAutoRec ? F("<option value='0' selected>Off</option><option value='1'>On</option>")
+                                : F("<option value='0'>Off</option><option value='1' selected>On</option>"));
+  out->print(F("</select></div>"));
+
+  out->print(F("<div><label>Raw ECU capture (.cap next to each log)</label><select name='rawCap'>"));
+  out->print(!setting_logRawCap ? F("<option value='0' selected>Off</option><option value='1'>On</option>")
+                                : F("<option value='0'>Off</option><option value='1' selected>On</option>"));
+  out->print(F("</select></div>"));
+
+  char smBuf[128];
+  snprintf(smBuf, sizeof(smBuf),
+           "<div><label>Needle smoothing (ms, 0 = off)</label><input name='gSmooth' type='number' min='0' max='1000' value='%u'></div>",
+           (unsigned)setting_gaugeSmoothMs);
+  out->print(smBuf);
+
+  char preBuf[128];
+  snprintf(preBuf, sizeof(preBuf),
+           "<div><label>Preallocate log file (MB, 0 = off)</label><input name='prealloc' type='number' min='0' max='4095' value='%u'></div>",
+           (unsigned)setting_logPreallocMb);
+  out->print(preBuf);
+
+  char pipeBuf[112];
+  snprintf(pipeBuf, sizeof(pipeBuf),
+           "<div><label>Requests in flight ('r')</label><input name='pipe' type='number' min='1' max='%d' value='%d'></div>",
+           R_PIPE_MAX, setting_pipeDepth);
+  out->print(pipeBuf);
+
+  char hzBuf[96];
+  snprintf(hzBuf, sizeof(hzBuf),
+           "<div><label>Max poll rate (Hz)</label><input name='pollHz' type='number' min='1' max='100' value='%d'></div>",
+           setting_pollMaxHz);
+  out->print(hzBuf);
+
+  out->print(F("<div><label>Shift Enable</label><select name='shiftEn'>"));
+  out->print(!setting_shiftEnabled ? F("<option value='0' selected>Off</option><option value='1'>On</option>")
                                            : F("<option value='0'>Off</option><option value='1' selected>On</option>"));
-  server.sendContent(F("</select></div>"));
+  out->print(F("</select></div>"));
 
   char rpmBuf[96];
   snprintf(rpmBuf, sizeof(rpmBuf),
            "<div><label>Shift RPM</label><input name='shiftRpm' type='number' min='0' max='%d' value='%d'></div>",
            RPM_MAX, setting_shiftRpm);
-  server.sendContent(rpmBuf);
+  out->print(rpmBuf);
 
-  server.sendContent(F("</div><p><button type='submit'>Save General</button></p></form></div>"));
+  out->print(F("</div><p><button type='submit'>Save General</button></p></form></div>"));
 
-  server.sendContent(F("<div class='card'><b>Tip</b><br>"
-                       "When a device is connected, the dashboard + serial polling are paused for maximum portal stability."
+  out->print(F("<div class='card'><b>Tip</b><br>"
+                       "The dashboard, ECU polling and logging keep running while the portal is open. "
+                       "The log being recorded is listed but can only be downloaded after REC is stopped."
                        "</div>"));
 
-  sendHtmlFooterLite();
-  server.sendContent(""); // end chunked response
-
-#if USE_SD
-  portalBusy = false;
-#endif
+  sendHtmlFooterLite(out);
+  req->send(out);
 }
 
 // Warnings page: separate to reduce load on /
-static void handleWarn() {
-#if USE_SD
-  portalBusy = true;
-  if (recording && logFile) logFile.flush();
-#endif
+static void handleWarn(AsyncWebServerRequest* req) {
+  PHASE_SCOPE(PH_HTTP);
 
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.sendHeader("Connection", "close");
-  server.send(200, "text/html", "");
-  sendHtmlHeaderLite("Warnings");
+  AsyncResponseStream* out = req->beginResponseStream("text/html");
+  sendHtmlHeaderLite(out, "Warnings");
 
-  server.sendContent(F("<div class='card'>"
+  out->print(F("<div class='card'>"
                        "<a href='/'>Home</a> &nbsp;|&nbsp; "
                        "<a href='/warn'>Warnings</a> &nbsp;|&nbsp; "
-                       "<a href='/logs'>SD Logs</a>"
+                       "<a href='/logs'>SD Logs</a> &nbsp;|&nbsp; "
+                       "<a href='/view'>Live</a>"
                        "</div>"));
 
   // Use /save handler; include required general fields as hidden so /save stays simple.
@@ -1857,17 +5060,17 @@ static void handleWarn() {
            "<input type='hidden' name='shiftEn' value='%d'>"
            "<input type='hidden' name='shiftRpm' value='%d'>",
            (int)setting_viewMode, (int)(setting_logEnabled?1:0), (int)(setting_shiftEnabled?1:0), (int)setting_shiftRpm);
-  server.sendContent(F("<div class='card'><h3>Warnings</h3>"));
-  server.sendContent(hid);
+  out->print(F("<div class='card'><h3>Warnings</h3>"));
+  out->print(hid);
 
-  server.sendContent(F("<table><tr><th>Item</th><th>Enable</th><th>Min</th><th>Max</th></tr>"));
+  out->print(F("<table><tr><th>Item</th><th>Enable</th><th>Min</th><th>Max</th></tr>"));
 
   for (int i=0;i<W_COUNT;i++) {
     const char* name = warnName(i);
 
     // Pre-format min/max as strings (small)
     char minStr[16], maxStr[16];
-    if (i==W_AFR || i==W_VBAT) {
+    if (warnOneDec(i)) {
       snprintf(minStr, sizeof(minStr), "%.1f", warnCfg[i].minV);
       snprintf(maxStr, sizeof(maxStr), "%.1f", warnCfg[i].maxV);
     } else {
@@ -1890,219 +5093,552 @@ static void handleWarn() {
              ( warnCfg[i].enabled ? " selected" : ""),
              i, minStr,
              i, maxStr);
-    server.sendContent(row);
-    yield();
+    out->print(row);
   }
 
-  server.sendContent(F("</table><p><button type='submit'>Save Warnings</button></p></form></div>"));
-
-  sendHtmlFooterLite();
-  server.sendContent("");
+  out->print(F("</table><p><button type='submit'>Save Warnings</button></p></form></div>"));
 
-#if USE_SD
-  portalBusy = false;
-#endif
+  sendHtmlFooterLite(out);
+  req->send(out);
 }
 
 // Logs page: separate, avoid Strings while listing
-static void handleLogs() {
-#if USE_SD
-  portalBusy = true;
-  if (recording && logFile) logFile.flush();
-#endif
+static void handleLogs(AsyncWebServerRequest* req) {
+  PHASE_SCOPE(PH_HTTP);
 
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.sendHeader("Connection", "close");
-  server.send(200, "text/html", "");
-  sendHtmlHeaderLite("SD Logs");
+  AsyncResponseStream* out = req->beginResponseStream("text/html");
+  sendHtmlHeaderLite(out, "SD Logs");
 
-  server.sendContent(F("<div class='card'>"
+  out->print(F("<div class='card'>"
                        "<a href='/'>Home</a> &nbsp;|&nbsp; "
                        "<a href='/warn'>Warnings</a> &nbsp;|&nbsp; "
-                       "<a href='/logs'>SD Logs</a>"
+                       "<a href='/logs'>SD Logs</a> &nbsp;|&nbsp; "
+                       "<a href='/view'>Live</a>"
                        "</div>"));
 
-  server.sendContent(F("<div class='card'><h3>SD Logs</h3>"));
+  out->print(F("<div class='card'><h3>SD Logs</h3>"));
 
 #if USE_SD
   if (!sdOk) {
-    server.sendContent(F("<p><b class='bad'>SD not detected.</b></p>"));
-  } else if (recording) {
-    server.sendContent(F("<p class='bad'><b>Recording is ON</b>. Stop REC to browse/download logs.</p>"));
-    server.sendContent(F("<p><a href='/rec'>Toggle REC</a></p>"));
+    out->print(F("<p><b class='bad'>SD not detected.</b></p>"));
   } else {
-    File root = SD.open("/");
-    if (!root) {
-      server.sendContent(F("<p class='bad'>Unable to open SD root.</p>"));
-    } else {
-      server.sendContent(F("<ul>"));
-      File f = root.openNextFile();
-      while (f) {
-        const char* n = f.name();
-        if (!f.isDirectory() && endsWithCsv(n)) {
-          char li[260];
-          // n may already have leading '/', but SD library varies; ensure URL uses raw name
-          const char* nUrl = (n && n[0] == '/') ? (n + 1) : n;
-          snprintf(li, sizeof(li),
-                   "<li><a href='/download?f=%s'>%s</a> (%lu bytes)</li>",
-                   nUrl ? nUrl : "", nUrl ? nUrl : "", (unsigned long)f.size());
-          server.sendContent(li);
-        }
-        f.close();
-        f = root.openNextFile();
-        yield();
+    // Served from the session index, newest first, LOGS_PER_PAGE per page (?p=0..).
+    static LogIndexEntry page[LOGS_PER_PAGE];
+    const uint32_t p = req->hasArg("p") ? (uint32_t)max(0L, req->arg("p").toInt()) : 0;
+    sdLock();
+    const uint32_t total = logIndexCount;
+    const uint32_t skip = p * LOGS_PER_PAGE;
+    size_t n = 0;
+    if (skip < total) {
+      const uint32_t last = total - skip;                     // one past the newest on this page
+      const uint32_t first = last > LOGS_PER_PAGE ? last - LOGS_PER_PAGE : 0;
+      n = logIndexRead(first, page, last - first);
+    }
+    sdUnlock();
+
+    if (recording) out->print(F("<p><b class='bad'>Recording is ON</b> (active file marked).</p>"));
+    out->print(F("<table><tr><th>File</th><th>Size</th><th>Duration</th><th>Max RPM</th><th>Min AFR</th><th></th></tr>"));
+    for (size_t i = n; i-- > 0;) {
+      const LogIndexEntry& e = page[i];
+      const char* nUrl = (e.name[0] == '/') ? e.name + 1 : e.name;
+      char link[320], sz[16], dur[16], rpm[8], afr[8];
+      if (e.flags & LIDX_OPEN) {
+        snprintf(link, sizeof(link), "%.16s (recording)", nUrl);
+      } else if (e.fmt != LOG_FMT_CSV) {
+        snprintf(link, sizeof(link), "<a href='/download?f=%.16s'>%.16s</a> <a href='/download?f=%.16s&amp;raw=1'>[raw]</a>%s",
+                 nUrl, nUrl, nUrl, (e.flags & LIDX_AUTO) ? " (auto)" : "");
+      } else {
+        snprintf(link, sizeof(link), "<a href='/download?f=%.16s'>%.16s</a>%s", nUrl, nUrl, (e.flags & LIDX_AUTO) ? " (auto)" : "");
+#if USE_REPLAY
+        const size_t k = strlen(link);
+        snprintf(link + k, sizeof(link) - k, " <a href='/replay?f=%.16s'>[replay]</a>", nUrl);
+#endif
+      }
+      if ((e.flags & LIDX_CAP) && !(e.flags & LIDX_OPEN)) {
+        char cap[24];
+        logSiblingPath(nUrl, "cap", cap, sizeof(cap));
+        const size_t k = strlen(link);
+#if USE_REPLAY
+        snprintf(link + k, sizeof(link) - k, " <a href='/download?f=%s'>[cap]</a> <a href='/replay?f=%s'>[replay cap]</a>", cap, cap);
+#else
+        snprintf(link + k, sizeof(link) - k, " <a href='/download?f=%s'>[cap]</a>", cap);
+#endif
       }
-      root.close();
-      server.sendContent(F("</ul>"));
+      if (e.flags & LIDX_OPEN) snprintf(sz, sizeof(sz), "-");
+      else snprintf(sz, sizeof(sz), "%lu kB", (unsigned long)((e.size + 1023) / 1024));
+      const bool stats = !(e.flags & (LIDX_OPEN | LIDX_NO_STATS));
+      if (stats) snprintf(dur, sizeof(dur), "%lu:%02lu", (unsigned long)(e.durationMs / 60000), (unsigned long)(e.durationMs / 1000 % 60));
+      else snprintf(dur, sizeof(dur), "-");
+      if (stats) snprintf(rpm, sizeof(rpm), "%u", (unsigned)e.maxRpm);
+      else snprintf(rpm, sizeof(rpm), "-");
+      if (stats && e.minAfrX100 != INT16_MAX) formatFixed(afr, sizeof(afr), e.minAfrX100, 2);
+      else snprintf(afr, sizeof(afr), "-");
+      char row[520];
+      snprintf(row, sizeof(row), "<tr><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td>"
+                                 "<td><a href='/summary?f=%.16s'>summary</a></td></tr>", link, sz, dur, rpm, afr, nUrl);
+      out->print(row);
     }
-    server.sendContent(F("<p><a href='/rec'>Toggle REC</a></p>"));
+    out->print(F("</table>"));
+    if (total == 0) out->print(F("<p>No logs yet.</p>"));
+
+    char nav[160];
+    int k = snprintf(nav, sizeof(nav), "<p>%lu logs", (unsigned long)total);
+    if (p > 0) k += snprintf(nav + k, sizeof(nav) - k, " &nbsp; <a href='/logs?p=%lu'>&laquo; Newer</a>", (unsigned long)(p - 1));
+    if (skip + LOGS_PER_PAGE < total) snprintf(nav + k, sizeof(nav) - k, " &nbsp; <a href='/logs?p=%lu'>Older &raquo;</a>", (unsigned long)(p + 1));
+    out->print(nav);
+    out->print(F("</p>"));
+    out->print(F("<p><a href='/rec'>Toggle REC</a></p>"));
+#if USE_REPLAY
+    if (replayActive) out->print(F("<p><b>Replay running</b> &nbsp; <a href='/replay?stop=1'>Stop replay</a></p>"));
+#endif
   }
 #else
-  server.sendContent(F("<p>SD support disabled in build.</p>"));
+  out->print(F("<p>SD support disabled in build.</p>"));
 #endif
 
-  server.sendContent(F("</div>"));
+  out->print(F("</div>"));
 
-  sendHtmlFooterLite();
-  server.sendContent("");
+  sendHtmlFooterLite(out);
+  req->send(out);
+}
 
+// Session summary: the running session straight from RAM, closed ones from their .sum file.
+static void handleSummary(AsyncWebServerRequest* req) {
+  PHASE_SCOPE(PH_HTTP);
 #if USE_SD
-  portalBusy = false;
+  if (!sdOk) { req->send(500, "text/plain", "SD not ready"); return; }
+  String fn = req->arg("f");
+  if (!fn.startsWith("/")) fn = "/" + fn;
+  if (fn.length() == 1 || fn.indexOf("..") >= 0) { req->send(400, "text/plain", "Bad f"); return; }
+
+  static LogSummary s;   // async_tcp is the only caller
+  bool ok = false, live = false;
+  sdLock();
+  if ((recording || logClosing) && strcmp(fn.c_str(), logFileName) == 0) {
+    s = logSum;
+    s.durationMs = millis() - logSess.startMs;
+    ok = live = true;
+  } else {
+    char sumPath[32];
+    logSiblingPath(fn.c_str(), "sum", sumPath, sizeof(sumPath));
+    File sf = SD.open(sumPath, FILE_READ);
+    ok = sf && sf.read((uint8_t*)&s, sizeof(s)) == sizeof(s) && memcmp(s.magic, "EDSM", 4) == 0 &&
+         s.version == SUM_VERSION && s.chCount == CH_COUNT && s.warnCount == W_COUNT;
+    if (sf) sf.close();
+  }
+  sdUnlock();
+  if (!ok) { req->send(404, "text/plain", "No summary for this log (older firmware, or not closed yet)"); return; }
+
+  AsyncResponseStream* out = req->beginResponseStream("text/html");
+  sendHtmlHeaderLite(out, "Summary");
+  out->print(F("<div class='card'><a href='/'>Home</a> &nbsp;|&nbsp; <a href='/logs'>SD Logs</a></div>"));
+
+  char buf[200];
+  snprintf(buf, sizeof(buf), "<div class='card'><h3>%s%s</h3><p>%lu:%02lu, %lu samples</p>",
+           fn.c_str() + 1, live ? " (recording)" : "", (unsigned long)(s.durationMs / 60000),
+           (unsigned long)(s.durationMs / 1000 % 60), (unsigned long)s.samples);
+  out->print(buf);
+
+  out->print(F("<h3>Time outside warning window</h3><table>"));
+  for (int w = 0; w < W_COUNT; w++) {
+    snprintf(buf, sizeof(buf), "<tr><td>%s</td><td>%lu.%lu s</td></tr>", warnName(w),
+             (unsigned long)(s.warnMs[w] / 1000), (unsigned long)(s.warnMs[w] / 100 % 10));
+    out->print(buf);
+  }
+  out->print(F("</table>"));
+
+  out->print(F("<h3>Channels</h3><table><tr><th>Channel</th><th>Min</th><th>Mean</th><th>Max</th></tr>"));
+  for (int i = 0; i < CH_COUNT && s.samples; i++) {
+    const uint8_t dec = CHANNELS[i].dec;
+    char mn[16], avg[16], mx[16];
+    formatFixed(mn, sizeof(mn), s.chMin[i], dec);
+    formatFixed(avg, sizeof(avg), (int32_t)(s.chSum[i] / (int64_t)s.samples), dec);
+    formatFixed(mx, sizeof(mx), s.chMax[i], dec);
+    snprintf(buf, sizeof(buf), "<tr><td>%s</td><td>%s</td><td>%s</td><td>%s</td></tr>", CHANNELS[i].name, mn, avg, mx);
+    out->print(buf);
+  }
+  out->print(F("</table>"));
+
+  // RPM rows x AFR columns, % of histogram samples.
+  uint32_t total = 0;
+  for (int r = 0; r < SUM_RPM_BINS; r++) for (int a = 0; a < SUM_AFR_BINS; a++) total += s.hist[r][a];
+  out->print(F("<h3>RPM x AFR (% of samples)</h3><table><tr><th>RPM</th>"));
+  for (int a = 0; a < SUM_AFR_BINS; a++) {
+    const int32_t lo = SUM_AFR_LO_X100 + (a - 1) * SUM_AFR_BIN_X100;
+    if (a == 0) snprintf(buf, sizeof(buf), "<th>&lt;%ld.%ld</th>", (long)(SUM_AFR_LO_X100 / 100), (long)(SUM_AFR_LO_X100 / 10 % 10));
+    else snprintf(buf, sizeof(buf), "<th>%s%ld.%ld</th>", a == SUM_AFR_BINS - 1 ? "&ge;" : "", (long)(lo / 100), (long)(lo / 10 % 10));
+    out->print(buf);
+  }
+  out->print(F("</tr>"));
+  for (int r = SUM_RPM_BINS - 1; r >= 0; r--) {
+    snprintf(buf, sizeof(buf), "<tr><td>%s%u</td>", r == SUM_RPM_BINS - 1 ? "&ge;" : "", (unsigned)(r * SUM_RPM_BIN));
+    out->print(buf);
+    for (int a = 0; a < SUM_AFR_BINS; a++) {
+      const uint32_t pm = total ? (uint32_t)((uint64_t)s.hist[r][a] * 1000 / total) : 0;   // per mille
+      if (s.hist[r][a] == 0) snprintf(buf, sizeof(buf), "<td></td>");
+      else snprintf(buf, sizeof(buf), "<td style='background:rgba(255,170,0,%.2f)'>%lu.%lu</td>",
+                    0.15f + 0.85f * min(1.0f, pm / 200.0f), (unsigned long)(pm / 10), (unsigned long)(pm % 10));
+      out->print(buf);
+    }
+    out->print(F("</tr>"));
+  }
+  out->print(F("</table></div>"));
+
+  sendHtmlFooterLite(out);
+  req->send(out);
+#else
+  req->send(500, "text/plain", "SD disabled");
 #endif
 }
 
 // Save handler (unchanged behavior, but used by both / and /warn)
-static void handleSave() {
-#if USE_SD
-  portalBusy = true;
-#endif
+static void handleSave(AsyncWebServerRequest* req) {
+  PHASE_SCOPE(PH_HTTP);
 
-  if (!server.hasArg("view") || !server.hasArg("logEn") || !server.hasArg("shiftEn") || !server.hasArg("shiftRpm")) {
-#if USE_SD
-    portalBusy = false;
-#endif
-    server.send(400, "text/plain", "Missing required fields");
+  if (!req->hasArg("view") || !req->hasArg("logEn") || !req->hasArg("shiftEn") || !req->hasArg("shiftRpm")) {
+    req->send(400, "text/plain", "Missing required fields");
     return;
   }
 
-  setting_viewMode = (uint8_t)server.arg("view").toInt();
-  setting_logEnabled = server.arg("logEn").toInt() == 1;
-  setting_shiftEnabled = server.arg("shiftEn").toInt() == 1;
-  setting_shiftRpm = clampi(server.arg("shiftRpm").toInt(), 0, RPM_MAX);
+  setting_viewMode = (uint8_t)req->arg("view").toInt();
+  setting_logEnabled = req->arg("logEn").toInt() == 1;
+  if (req->hasArg("logAll")) setting_logEveryFrame = req->arg("logAll").toInt() == 1;
+  if (req->hasArg("logFmt")) setting_logFmt = (uint8_t)clampi(req->arg("logFmt").toInt(), LOG_FMT_CSV, LOG_FMT_COUNT - 1);
+  if (req->hasArg("dbgOv")) setting_statsOverlay = req->arg("dbgOv").toInt() == 1;
+  if (req->hasArg("gov")) setting_govEnabled = req->arg("gov").toInt() == 1;
+  if (req->hasArg("proto")) setting_ecuProto = (req->arg("proto").toInt() == 1) ? PROTO_R : PROTO_N;
+  if (req->hasArg("ecuIn")) setting_ecuInput = (uint8_t)clampi(req->arg("ecuIn").toInt(), IN_SERIAL, IN_COUNT - 1);
+  if (req->hasArg("canWbo")) setting_canWbo = req->arg("canWbo").toInt() == 1;
+  if (req->hasArg("bbAuto")) setting_bbAutoRec = req->arg("bbAuto").toInt() == 1;
+  if (req->hasArg("rawCap")) setting_logRawCap = req->arg("rawCap").toInt() == 1;
+  if (req->hasArg("gSmooth")) setting_gaugeSmoothMs = (uint16_t)clampi(req->arg("gSmooth").toInt(), 0, 1000);
+  if (req->hasArg("prealloc")) setting_logPreallocMb = (uint16_t)clampi(req->arg("prealloc").toInt(), 0, 4095);   // FAT32: files < 4 GiB
+  if (req->hasArg("pipe")) setting_pipeDepth = (uint8_t)clampi(req->arg("pipe").toInt(), 1, R_PIPE_MAX);
+  if (req->hasArg("pollHz")) setting_pollMaxHz = (uint8_t)clampi(req->arg("pollHz").toInt(), 1, 100);
+  setting_shiftEnabled = req->arg("shiftEn").toInt() == 1;
+  setting_shiftRpm = clampi(req->arg("shiftRpm").toInt(), 0, RPM_MAX);
 
   // Warnings are optional in this POST (root page doesn't send them)
   for (int i=0;i<W_COUNT;i++) {
     String ke = "w" + String(i) + "e";
     String kmin = "w" + String(i) + "min";
     String kmax = "w" + String(i) + "max";
-    if (!server.hasArg(ke) || !server.hasArg(kmin) || !server.hasArg(kmax)) continue;
+    if (!req->hasArg(ke) || !req->hasArg(kmin) || !req->hasArg(kmax)) continue;
 
-    warnCfg[i].enabled = server.arg(ke).toInt() == 1;
-    warnCfg[i].minV = server.arg(kmin).toFloat();
-    warnCfg[i].maxV = server.arg(kmax).toFloat();
+    warnCfg[i].enabled = req->arg(ke).toInt() == 1;
+    warnCfg[i].minV = req->arg(kmin).toFloat();
+    warnCfg[i].maxV = req->arg(kmax).toFloat();
     if (warnCfg[i].minV > warnCfg[i].maxV) {
       float mid = 0.5f * (warnCfg[i].minV + warnCfg[i].maxV);
       warnCfg[i].minV = warnCfg[i].maxV = mid;
     }
-    yield();
   }
 
-  saveSettings();
-  apply_view_layout();
-  refresh_settings_list();
-  flashSaved();
+  // NVS and LVGL belong to the render task; it applies these on its next pass.
+  settingsChanged();
+  uiRequest(UI_REQ_APPLY);
 
-#if USE_SD
-  portalBusy = false;
-#endif
-  server.sendHeader("Location", "/?saved=1");
-  server.send(303);
+  sendRedirect(req, "/?saved=1");
 }
 
 
-static void handleDownloadLatest() {
+static void handleDownloadLatest(AsyncWebServerRequest* req) {
+  PHASE_SCOPE(PH_HTTP);
 #if USE_SD
-  portalBusy = true;
-
-  if(!sdOk){ portalBusy = false; server.send(500, "text/plain", "SD not ready"); return; }
-  if (recording) { portalBusy = false; server.send(409, "text/plain", "Stop REC before download"); return; }
-
-  // Latest completed log is (setting_logIndex - 1) because we increment index on startRecording()
-  uint32_t idx = (setting_logIndex > 0) ? (setting_logIndex - 1) : 0;
-  if (idx == 0) { portalBusy = false; server.send(404, "text/plain", "No logs yet"); return; }
-
-  char fn[32];
-  snprintf(fn, sizeof(fn), "/log_%05lu.csv", (unsigned long)idx);
-
-  if(!SD.exists(fn)){ portalBusy = false; server.send(404, "text/plain", "Not found"); return; }
-
-  File f = SD.open(fn, FILE_READ);
-  if(!f){ portalBusy = false; server.send(404, "text/plain", "Not found"); return; }
+  if(!sdOk){ req->send(500, "text/plain", "SD not ready"); return; }
+
+  // Newest closed session in the index (the last entry is open while recording).
+  LogIndexEntry e;
+  bool found = false;
+  sdLock();
+  for (uint32_t i = logIndexCount; i-- > 0 && !found;) {
+    found = logIndexRead(i, &e, 1) == 1 && !(e.flags & LIDX_OPEN);
+  }
+  sdUnlock();
+  if (!found) { req->send(404, "text/plain", "No logs yet"); return; }
 
-  server.sendHeader("Content-Disposition", String("attachment; filename=\"") + String(fn+1) + "\"");
-  server.streamFile(f, "text/csv");
-  f.close();
-  portalBusy = false;
+  char fn[sizeof(e.name) + 1];
+  memcpy(fn, e.name, sizeof(e.name));
+  fn[sizeof(e.name)] = 0;
+  sendLogFile(req, fn);
 #else
-  server.send(500, "text/plain", "SD disabled");
+  req->send(500, "text/plain", "SD disabled");
 #endif
 }
 
-static void handleDownload() {
+static void handleDownload(AsyncWebServerRequest* req) {
+  PHASE_SCOPE(PH_HTTP);
 #if USE_SD
-  portalBusy = true;
-
-  if(!sdOk){ portalBusy = false; server.send(500, "text/plain", "SD not ready"); return; }
-  if (recording) { portalBusy = false; server.send(409, "text/plain", "Stop REC before download"); return; }
+  if(!sdOk){ req->send(500, "text/plain", "SD not ready"); return; }
 
   String fn;
-  if (server.hasArg("i")) {
-    long idx = server.arg("i").toInt();
-    if (idx < 1) { portalBusy = false; server.send(400, "text/plain", "Bad i"); return; }
+  if (req->hasArg("i")) {
+    long idx = req->arg("i").toInt();
+    if (idx < 1) { req->send(400, "text/plain", "Bad i"); return; }
     char b[32];
-    snprintf(b, sizeof(b), "/log_%05ld.csv", idx);
+    if (!findLogByIndex((uint32_t)idx, b, sizeof(b))) { req->send(404, "text/plain", "Not found"); return; }
     fn = String(b);
   } else {
-    fn = server.arg("f");
-    if(fn.length()==0){ portalBusy = false; server.send(400, "text/plain", "Missing f"); return; }
+    fn = req->arg("f");
+    if(fn.length()==0){ req->send(400, "text/plain", "Missing f"); return; }
     if(!fn.startsWith("/")) fn = "/"+fn;
   }
   if(!fn.startsWith("/")) fn = "/"+fn;
-  if(fn.indexOf("..") >= 0){ portalBusy = false; server.send(400, "text/plain", "Bad path"); return; }
-  if(!SD.exists(fn.c_str())){ portalBusy = false; server.send(404, "text/plain", "Not found"); return; }
-
-  File f = SD.open(fn.c_str(), FILE_READ);
-  if(!f){ portalBusy = false; server.send(404, "text/plain", "Not found"); return; }
+  if(fn.indexOf("..") >= 0){ req->send(400, "text/plain", "Bad path"); return; }
+  if(!sdExists(fn.c_str())){ req->send(404, "text/plain", "Not found"); return; }
 
-  server.sendHeader("Content-Disposition", "attachment; filename=\""+fn.substring(1)+"\"");
-  server.streamFile(f, "text/csv");
-  f.close();
-  portalBusy = false;
+  sendLogFile(req, fn.c_str());
 #else
-  server.send(500, "text/plain", "SD disabled");
+  req->send(500, "text/plain", "SD disabled");
 #endif
 }
 
-static void handleRec() {
+static void handleRec(AsyncWebServerRequest* req) {
+  PHASE_SCOPE(PH_HTTP);
 #if USE_SD
-  portalBusy = true;
-  if(!sdOk){ portalBusy = false; server.send(500, "text/plain", "SD not ready"); return; }
+  if(!sdOk){ req->send(500, "text/plain", "SD not ready"); return; }
 
   if (!recording) (void)startRecording();
   else stopRecording();
 
-  portalBusy = false;
-  server.sendHeader("Location","/logs");
-  server.send(303);
+  sendRedirect(req, "/logs");
+#else
+  req->send(500, "text/plain", "SD disabled");
+#endif
+}
+
+#if USE_REPLAY
+// /replay?f=log_00003.csv|.cap[&speed=1..16][&loop=1] starts, /replay?stop=1 stops; both answer
+// with the current state. acqTask picks the command up within a millisecond.
+static void handleReplay(AsyncWebServerRequest* req) {
+  PHASE_SCOPE(PH_HTTP);
+  if (!sdOk) { req->send(500, "text/plain", "SD not ready"); return; }
+  if (req->hasArg("stop")) {
+    replayCmd.store(REPLAY_STOP, std::memory_order_release);
+  } else if (req->hasArg("f")) {
+    String fn = req->arg("f");
+    if (!fn.startsWith("/")) fn = "/" + fn;
+    if (fn.indexOf("..") >= 0 || !(endsWithCsv(fn.c_str()) || endsWithExt(fn.c_str(), "cap"))) {
+      req->send(400, "text/plain", "CSV logs and .cap captures only");
+      return;
+    }
+    if (isActiveLog(fn.c_str())) { req->send(409, "text/plain", "File is being recorded"); return; }
+    snprintf(replayReqPath, sizeof(replayReqPath), "%s", fn.c_str());
+    replayReqSpeed = (uint8_t)clampi(req->hasArg("speed") ? req->arg("speed").toInt() : 1, 1, 16);
+    replayReqLoop = req->hasArg("loop") && req->arg("loop").toInt() != 0;
+    replayCmd.store(REPLAY_START, std::memory_order_release);
+  }
+  char buf[128];
+  snprintf(buf, sizeof(buf), "{\"active\":%s,\"file\":\"%s\",\"frames\":%lu}",
+           replayActive ? "true" : "false", replayActive ? replayName : "", (unsigned long)replayFrames);
+  AsyncWebServerResponse* res = req->beginResponse(200, "application/json", buf);
+  res->addHeader("Cache-Control", "no-store");
+  req->send(res);
+}
+#endif
+
+#if USE_BENCH
+// /bench?run=1 queues a run on the render task; /bench returns the last one (see benchRun()).
+static void handleBench(AsyncWebServerRequest* req) {
+  PHASE_SCOPE(PH_HTTP);
+  if (req->hasArg("run")) {
+    uiRequest(UI_REQ_BENCH);
+    req->send(202, "text/plain", "Benchmark queued, GET /bench for the result");
+    return;
+  }
+  const BenchResult r = benchLast;
+  char buf[192];
+  snprintf(buf, sizeof(buf), "{\"runMs\":%lu,\"decodeNs\":%lu,\"csvNs\":%lu,\"binNs\":%lu,\"deltaNs\":%lu,"
+                             "\"tilesUs\":%lu,\"renderUs\":%lu}",
+           (unsigned long)r.runMs, (unsigned long)r.decodeNs, (unsigned long)r.csvNs, (unsigned long)r.binNs,
+           (unsigned long)r.deltaNs, (unsigned long)r.tilesUs, (unsigned long)r.renderUs);
+  AsyncWebServerResponse* res = req->beginResponse(200, "application/json", buf);
+  res->addHeader("Cache-Control", "no-store");
+  req->send(res);
+}
+#endif
+
+// ============================= Live telemetry (/live) =============================
+#if USE_LIVE
+// WebSocket at /live. On connect a client gets the .bin preamble (BinLogHeader + channel
+// table, see binLogPreamble()); every later binary message is 1..LIVE_QUEUE_LEN records of
+// BIN_LOG_RECORD_SIZE bytes, oldest first. /view is a small page that decodes this.
+//
+// liveTask samples the EcuData snapshot, so acquisition never waits on a client. Each client
+// has its own ring of LIVE_QUEUE_LEN records: when its socket queue is full the ring keeps the
+// newest records and drops the oldest; once the socket drains, the whole ring goes out as one
+// message.
+static const uint32_t    LIVE_PUSH_MS     = 20;   // sample period (only new frames are sent)
+static const uint8_t     LIVE_MAX_CLIENTS = 4;
+static const uint8_t     LIVE_QUEUE_LEN   = 8;
+static const BaseType_t  LIVE_TASK_CORE   = 0;
+static const UBaseType_t LIVE_TASK_PRIO   = 1;    // below acqTask/logTask
+static const uint32_t    LIVE_TASK_STACK  = 4096;
+
+struct LiveClient {
+  uint32_t id;                                  // AsyncWebSocketClient id, 0 = free slot
+  uint8_t  head, count;
+  uint8_t  rec[LIVE_QUEUE_LEN][BIN_LOG_RECORD_SIZE];
+};
+
+static AsyncWebSocket liveWs("/live");
+static LiveClient liveClients[LIVE_MAX_CLIENTS];
+static portMUX_TYPE liveMux = portMUX_INITIALIZER_UNLOCKED;   // slots: async_tcp vs liveTask
+static uint8_t livePreamble[BIN_LOG_PREAMBLE_SIZE];
+static volatile uint32_t liveDrops = 0;
+static TaskHandle_t liveTaskHandle = nullptr;
+
+// Runs in async_tcp.
+static void onLiveEvent(AsyncWebSocket*, AsyncWebSocketClient* c, AwsEventType type, void*, uint8_t*, size_t) {
+  if (type == WS_EVT_CONNECT) {
+    // Preamble first, so it is queued ahead of any record liveTask sends once the slot is live.
+    c->binary(livePreamble, sizeof(livePreamble));
+    bool placed = false;
+    portENTER_CRITICAL(&liveMux);
+    for (LiveClient& lc : liveClients) {
+      if (lc.id) continue;
+      lc.id = c->id();
+      lc.head = lc.count = 0;
+      placed = true;
+      break;
+    }
+    portEXIT_CRITICAL(&liveMux);
+    if (!placed) c->close(1013, "Too many live clients");
+  } else if (type == WS_EVT_DISCONNECT) {
+    portENTER_CRITICAL(&liveMux);
+    for (LiveClient& lc : liveClients) if (lc.id == c->id()) lc.id = 0;
+    portEXIT_CRITICAL(&liveMux);
+  }
+}
+
+static void liveTask(void*) {
+  static uint8_t batch[LIVE_QUEUE_LEN * BIN_LOG_RECORD_SIZE];
+  uint32_t lastFrameMs = 0, lastCleanupMs = 0;
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(LIVE_PUSH_MS));
+    if (millis() - lastCleanupMs > 1000) { liveWs.cleanupClients(LIVE_MAX_CLIENTS); lastCleanupMs = millis(); }
+    if (liveWs.count() == 0) continue;
+
+    PHASE_SCOPE(PH_LIVE);
+    EcuData ecu;
+    ecuSnapshot(ecu);
+    const bool fresh = ecu.lastUpdateMs != lastFrameMs;
+    lastFrameMs = ecu.lastUpdateMs;
+    uint8_t rec[BIN_LOG_RECORD_SIZE];
+    if (fresh) binLogPack(ecu, ecu.lastUpdateMs, rec);
+
+    for (LiveClient& lc : liveClients) {
+      portENTER_CRITICAL(&liveMux);
+      const uint32_t id = lc.id;
+      if (id && fresh) {
+        const uint8_t slot = (lc.head + lc.count) % LIVE_QUEUE_LEN;
+        memcpy(lc.rec[slot], rec, BIN_LOG_RECORD_SIZE);
+        if (lc.count < LIVE_QUEUE_LEN) lc.count++;
+        else { lc.head = (lc.head + 1) % LIVE_QUEUE_LEN; liveDrops = liveDrops + 1; }
+      }
+      const bool pending = id && lc.count;
+      portEXIT_CRITICAL(&liveMux);
+      if (!pending || !liveWs.availableForWrite(id)) continue;
+
+      size_t n = 0;
+      portENTER_CRITICAL(&liveMux);
+      if (lc.id == id) {
+        for (uint8_t i = 0; i < lc.count; i++, n += BIN_LOG_RECORD_SIZE)
+          memcpy(batch + n, lc.rec[(lc.head + i) % LIVE_QUEUE_LEN], BIN_LOG_RECORD_SIZE);
+        lc.head = lc.count = 0;
+      }
+      portEXIT_CRITICAL(&liveMux);
+      if (n) liveWs.binary(id, batch, n);
+    }
+  }
+}
+
+// Pit-side view: decodes the preamble and shows the newest record as a table.
+static const char LIVE_PAGE[] PROGMEM = R"HTML(<!doctype html><html><head><meta name='viewport' content='width=device-width,initial-scale=1'>
+<title>ESP Dash Live</title><style>body{font-family:Arial;margin:12px;background:#111;color:#eee;max-width:820px}
+a{color:#7af}table{width:100%;border-collapse:collapse}td{padding:4px 6px;border-bottom:1px solid #333}
+td:last-child{text-align:right;font-family:monospace;font-size:18px}#st{color:#aaa}</style></head><body>
+<p><a href='/'>Home</a> &nbsp;|&nbsp; <span id='st'>connecting...</span></p><table id='t'></table><script>
+let ch=[],rs=0,cells=[],n=0,t0=Date.now();const st=document.getElementById('st');
+function rd(d,o,c){const p=o+c.o;switch(c.t){case 0:return d.getUint8(p);case 1:return d.getInt8(p);
+case 2:return d.getUint16(p,true);case 3:return d.getInt16(p,true);case 4:return d.getUint32(p,true);
+case 5:return (d.getUint8(p)>>c.b)&1;}return 0;}
+function go(){const ws=new WebSocket('ws://'+location.host+'/live');ws.binaryType='arraybuffer';
+ws.onclose=()=>{st.textContent='disconnected, retrying';setTimeout(go,1000);};
+ws.onmessage=e=>{const d=new DataView(e.data);
+if(d.byteLength>=12&&d.getUint32(0)==0x45444c47){const c=d.getUint8(5);rs=d.getUint16(6,true);ch=[];
+const tb=document.getElementById('t');tb.innerHTML='';cells=[];
+for(let i=0,o=12;i<c;i++,o+=18){let s='';for(let k=0;k<10;k++){const x=d.getUint8(o+k);if(x)s+=String.fromCharCode(x);}
+ch.push({n:s,t:d.getUint8(o+10),o:d.getUint8(o+11),d:d.getUint8(o+12),b:d.getUint8(o+13),m:d.getInt16(o+14,true),z:d.getInt16(o+16,true)});
+const r=tb.insertRow();r.insertCell().textContent=s;cells.push(r.insertCell());}return;}
+if(!rs||d.byteLength<rs)return;const o=d.byteLength-rs;n+=d.byteLength/rs;
+ch.forEach((c,i)=>{cells[i].textContent=((rd(d,o,c)*c.m+c.z)/Math.pow(10,c.d)).toFixed(c.d);});
+const now=Date.now();if(now-t0>=1000){st.textContent=n+' frames/s';n=0;t0=now;}};}
+go();</script></body></html>)HTML";
+
+static void handleLiveView(AsyncWebServerRequest* req) {
+  req->send(200, "text/html", LIVE_PAGE);
+}
+
+static void liveSetup() {
+  binLogPreamble(livePreamble, 0);
+  liveWs.onEvent(onLiveEvent);
+  server.addHandler(&liveWs);
+  server.on("/view", HTTP_GET, handleLiveView);
+  xTaskCreatePinnedToCore(liveTask, "live", LIVE_TASK_STACK, nullptr, LIVE_TASK_PRIO, &liveTaskHandle, LIVE_TASK_CORE);
+}
+#endif // USE_LIVE
+
+// Phase timing as JSON (us, last PHASE_WINDOW_MS window per phase).
+static void handleStats(AsyncWebServerRequest* req) {
+#if USE_PHASE_STATS
+  char buf[PH_COUNT * 96 + 768];
+  int n = snprintf(buf, sizeof(buf), "{\"windowMs\":%lu,\"cpuMhz\":%lu,\"freeHeap\":%lu,\"warn\":%u,\"phases\":{",
+                   (unsigned long)PHASE_WINDOW_MS, (unsigned long)phaseCpuMhz, (unsigned long)ESP.getFreeHeap(),
+                   (unsigned)warnMask.load(std::memory_order_relaxed));
+  for (int i = 0; i < PH_COUNT && n < (int)sizeof(buf); i++) {
+    const PhaseSummary s = phaseOut[i];
+    n += snprintf(buf + n, sizeof(buf) - n,
+                  "%s\"%s\":{\"n\":%lu,\"min\":%lu,\"avg\":%lu,\"p99\":%lu,\"max\":%lu}",
+                  i ? "," : "", PHASE_NAMES[i], (unsigned long)s.n, (unsigned long)s.minUs,
+                  (unsigned long)s.avgUs, (unsigned long)s.p99Us, (unsigned long)s.maxUs);
+  }
+  if (n < (int)sizeof(buf)) n += snprintf(buf + n, sizeof(buf) - n, "}");
+#if USE_LIVE
+  if (n < (int)sizeof(buf)) n += snprintf(buf + n, sizeof(buf) - n, ",\"liveClients\":%u,\"liveDrops\":%lu",
+                                          (unsigned)liveWs.count(), (unsigned long)liveDrops);
+#endif
+#if USE_SD
+  if (n < (int)sizeof(buf)) n += snprintf(buf + n, sizeof(buf) - n, ",\"download\":{\"active\":%lu,\"bytes\":%lu,\"lastKBps\":%lu}",
+                                          (unsigned long)dlActive.load(), (unsigned long)dlBytes.load(), (unsigned long)dlLastKBps);
+  if (n < (int)sizeof(buf)) n += snprintf(buf + n, sizeof(buf) - n, ",\"capDrops\":%lu", (unsigned long)capDrops);
+#endif
+#if USE_TOUCH
+  if (n < (int)sizeof(buf)) n += snprintf(buf + n, sizeof(buf) - n, ",\"touch\":{\"irq\":%s,\"spiReads\":%lu}",
+                                          touchIrqOk ? "true" : "false", (unsigned long)touchSpiReads);
+#endif
+#if USE_CAN
+  if (n < (int)sizeof(buf)) n += snprintf(buf + n, sizeof(buf) - n, ",\"can\":{\"up\":%s,\"frames\":%lu,\"merges\":%lu,\"missed\":%lu,\"busOff\":%lu}",
+                                          canUp ? "true" : "false", (unsigned long)canFrames, (unsigned long)canMerges,
+                                          (unsigned long)canMissed, (unsigned long)canBusOffs);
+#endif
+#if USE_GOVERNOR
+  if (n + 1 < (int)sizeof(buf)) { buf[n++] = ','; n += gov_stats_json(buf + n, sizeof(buf) - n); }
+#endif
+  if (n < (int)sizeof(buf)) snprintf(buf + n, sizeof(buf) - n, "}");
+  AsyncWebServerResponse* res = req->beginResponse(200, "application/json", buf);
+  res->addHeader("Cache-Control", "no-store");
+  req->send(res);
 #else
-  server.send(500, "text/plain", "SD disabled");
+  req->send(404, "text/plain", "Phase stats disabled (USE_PHASE_STATS 0)");
 #endif
 }
 
-static void handleReboot() {
-  server.send(200, "text/plain", "Rebooting...");
-  delay(200);
-  ESP.restart();
+static void handleReboot(AsyncWebServerRequest* req) {
+  // Restart once the reply is out; blocking here would stall the async_tcp task.
+  // Settings still inside the coalescing window are written first.
+  req->onDisconnect([]() { prefsFlush(); ESP.restart(); });
+  req->send(200, "text/plain", "Rebooting...");
 }
 
 static void wifiSetupInternal() {
@@ -2119,8 +5655,19 @@ static void wifiSetupInternal() {
   server.on("/downloadLatest", HTTP_GET, handleDownloadLatest);
   server.on("/rec", HTTP_GET, handleRec);
   server.on("/reboot", HTTP_GET, handleReboot);
+  server.on("/stats", HTTP_GET, handleStats);
+  server.on("/summary", HTTP_GET, handleSummary);
+#if USE_REPLAY
+  server.on("/replay", HTTP_GET, handleReplay);
+#endif
+#if USE_BENCH
+  server.on("/bench", HTTP_GET, handleBench);
+#endif
+#if USE_LIVE
+  liveSetup();
+#endif
 
-  server.onNotFound([](){ server.send(404, "text/plain", "Not found"); });
+  server.onNotFound([](AsyncWebServerRequest* req){ req->send(404, "text/plain", "Not found"); });
   server.begin();
 }
 
@@ -2136,23 +5683,139 @@ void wifiSetup(){
 #endif
 }
 
+// Kept for the sketch; the async server needs no polling.
 void wifiLoop(){
-#if USE_WIFI
-  server.handleClient();
+}
 
-#if PAUSE_UI_WHEN_WIFI_CLIENT
+// ============================= Performance governor =============================
+#if USE_GOVERNOR
+// Every GOV_EVAL_MS the render task works out what the dash needs and applies one profile:
+// CPU clock, LVGL refresh period, dash update period, ECU poll cap, and how long dashLoop()
+// may sleep when LVGL has nothing due (so core 1 can reach idle). Raising a level is
+// immediate; lowering waits until the lower demand has held for GOV_HOLD_MS.
+//   idle:   no link, or engine off for GOV_OFF_IDLE_MS, nobody touching the screen or on WiFi
+//   cruise: engine running, recent touch / settings screen, a WiFi client, or REC on
+//   race:   rpm >= GOV_RACE_RPM or tps >= GOV_RACE_TPS, or a log download in progress
+// With setting_govEnabled off, GOV_FIXED keeps the old full-speed behaviour.
+// 80 MHz is the floor: below it the APB clock (UART, SPI) and WiFi would change.
+enum GovLevel : uint8_t { GOV_IDLE = 0, GOV_CRUISE, GOV_RACE, GOV_FIXED, GOV_LEVELS };
+struct GovProfile {
+  const char* name;
+  uint16_t cpuMhz;
+  uint16_t refrMs;    // LVGL display refresh timer
+  uint16_t uiMs;      // update_dash_values() period
+  uint8_t  pollHz;    // cap on setting_pollMaxHz
+  uint8_t  sleepMs;   // longest dashLoop() sleep, 0: never sleeps
+};
+static const GovProfile GOV_PROFILES[GOV_LEVELS] = {
+  { "idle",    80, 100, 200,  10, 20 },
+  { "cruise", 160,  30,  60, 100,  5 },
+  { "race",   240,  20,  40, 100,  0 },
+  { "fixed",  240,  30, UI_UPDATE_MS, 100, 0 },
+};
+static const uint32_t GOV_EVAL_MS = 250;
+static const uint32_t GOV_HOLD_MS = 5000;
+static const uint32_t GOV_OFF_IDLE_MS = 10000;   // link up, rpm 0: stay in cruise this long
+static const uint32_t GOV_TOUCH_MS = 10000;      // screen activity keeps at least cruise
+static const int GOV_RACE_RPM = 4000;
+static const int GOV_RACE_TPS = 50;
+
+struct GovEvent { uint32_t ms; uint8_t from, to; const char* why; };
+static const uint8_t GOV_LOG_LEN = 4;
+static GovEvent govLog[GOV_LOG_LEN];   // ring, newest at (govChanges - 1) % GOV_LOG_LEN
+static uint32_t govChanges = 0;
+static uint8_t govLevel = GOV_LEVELS;  // applied profile (GOV_LEVELS: none yet)
+static uint32_t govUiMs = UI_UPDATE_MS;
+static uint8_t govSleepMs = 0;
+
+static uint8_t gov_demand(const char*& why) {
+  static uint32_t lastRunMs = 0;
   const uint32_t now = millis();
-  if (now - lastWifiClientCheckMs >= WIFI_CLIENT_CHECK_MS) {
-    lastWifiClientCheckMs = now;
-    int n = WiFi.softAPgetStationNum();
-
-    // Only touch LVGL (setUiPaused) after dashSetup has completed LVGL init + UI build
-    if (lvReady) setPortalMode(n > 0);
-  }
+  EcuData ecu;
+  ecuSnapshot(ecu);
+  const int rpm = (ecuFreshMask(ecu, now) & chBit(CH_RPM)) ? chInt(ecu, CH_RPM) : 0;
+  if (rpm > 0) lastRunMs = now;
+
+  uint8_t lvl = GOV_IDLE;
+  why = linkValid ? "engine off" : "no link";
+  auto raise = [&](uint8_t l, const char* w) { if (l > lvl) { lvl = l; why = w; } };
+  if (linkValid && now - lastRunMs < GOV_OFF_IDLE_MS) raise(GOV_CRUISE, rpm > 0 ? "running" : "just stopped");
+  if (lv_disp_get_inactive_time(NULL) < GOV_TOUCH_MS || lv_scr_act() == scr_settings) raise(GOV_CRUISE, "touch");
+#if USE_SD
+  if (recording) raise(GOV_CRUISE, "recording");   // a log keeps full poll rate, engine off or not
+#endif
+#if USE_WIFI
+  if (WiFi.softAPgetStationNum() > 0) raise(GOV_CRUISE, "wifi client");
+#if USE_SD
+  if (dlActive.load() > 0) raise(GOV_RACE, "download");
 #endif
+#endif
+  if (rpm >= GOV_RACE_RPM || (linkValid && chInt(ecu, CH_TPS) >= GOV_RACE_TPS)) raise(GOV_RACE, "high load");
+  return lvl;
+}
 
+static void gov_apply(uint8_t lvl, const char* why) {
+  const GovProfile& p = GOV_PROFILES[lvl];
+  if (govLevel == GOV_LEVELS || GOV_PROFILES[govLevel].cpuMhz != p.cpuMhz) {
+    setCpuFrequencyMhz(p.cpuMhz);
+#if USE_PHASE_STATS
+    phaseCpuMhz = getCpuFrequencyMhz();   // cycle counts of the current window mix clocks once
 #endif
+  }
+  lv_timer_set_period(lv_disp_get_refr_timer(lv_disp_get_default()), p.refrMs);
+  govUiMs = p.uiMs;
+  govSleepMs = p.sleepMs;
+  govPollHz.store(p.pollHz, std::memory_order_relaxed);
+
+  if (govLevel != GOV_LEVELS) {
+    govLog[govChanges % GOV_LOG_LEN] = GovEvent{ millis(), govLevel, lvl, why };
+    govChanges++;
+    DBG_PRINTF("[GOV] %s -> %s (%s)\n", GOV_PROFILES[govLevel].name, p.name, why);
+  }
+  govLevel = lvl;
+}
+
+// Render task, every dashLoop() pass.
+static void gov_update() {
+  static uint32_t lastEval = 0, lowerSince = 0;
+  const uint32_t now = millis();
+  if (govLevel != GOV_LEVELS && now - lastEval < GOV_EVAL_MS) return;
+  lastEval = now;
+
+  const char* why = "disabled";
+  const uint8_t want = setting_govEnabled ? gov_demand(why) : (uint8_t)GOV_FIXED;
+  if (want == govLevel) { lowerSince = 0; return; }
+  const bool lower = govLevel != GOV_LEVELS && govLevel != GOV_FIXED && want != GOV_FIXED && want < govLevel;
+  if (lower) {
+    if (lowerSince == 0) lowerSince = now;
+    if (now - lowerSince < GOV_HOLD_MS) return;
+  }
+  lowerSince = 0;
+  gov_apply(want, why);
+}
+
+// Render task, end of dashLoop(): sleep until LVGL's next timer, up to the profile's limit.
+static void gov_sleep(uint32_t lvglIdleMs) {
+  const uint32_t ms = min(lvglIdleMs, (uint32_t)govSleepMs);
+  if (ms) vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+// "gov" object for /stats; returns chars written.
+static int gov_stats_json(char* out, size_t sz) {
+  const uint8_t lvl = govLevel < GOV_LEVELS ? govLevel : (uint8_t)GOV_FIXED;
+  const GovProfile& p = GOV_PROFILES[lvl];
+  int n = snprintf(out, sz, "\"gov\":{\"level\":\"%s\",\"cpuMhz\":%u,\"refrMs\":%u,\"uiMs\":%u,\"pollHz\":%u,\"changes\":%lu,\"log\":[",
+                   p.name, (unsigned)p.cpuMhz, (unsigned)p.refrMs, (unsigned)p.uiMs, (unsigned)p.pollHz, (unsigned long)govChanges);
+  const uint32_t count = min(govChanges, (uint32_t)GOV_LOG_LEN);
+  for (uint32_t i = 0; i < count && n < (int)sz; i++) {
+    const GovEvent e = govLog[(govChanges - 1 - i) % GOV_LOG_LEN];
+    n += snprintf(out + n, sz - n, "%s{\"ms\":%lu,\"from\":\"%s\",\"to\":\"%s\",\"why\":\"%s\"}", i ? "," : "",
+                  (unsigned long)e.ms, GOV_PROFILES[e.from].name, GOV_PROFILES[e.to].name, e.why);
+  }
+  if (n < (int)sz) n += snprintf(out + n, sz - n, "]}");
+  return n;
 }
+#endif
 
 // ============================= Public API: dashSetup/dashLoop =============================
 void dashSetup() {
@@ -2161,7 +5824,12 @@ void dashSetup() {
   Serial.print("Speeduino Dashboard LVGL ");
   Serial.println(FW_VERSION);
 
+  prefsMutex = xSemaphoreCreateMutex();
+  ecuMergeMutex = xSemaphoreCreateMutex();
   loadSettings();
+#if USE_PHASE_STATS
+  phaseCpuMhz = getCpuFrequencyMhz();
+#endif
 
   tft.begin();
   tft.setRotation(1);
@@ -2178,21 +5846,35 @@ void dashSetup() {
 #if USE_SD
   sdSpi.begin(SD_VSPI_SCK, SD_VSPI_MISO, SD_VSPI_MOSI, SD_VSPI_SS);
   sdOk = SD.begin(SD_VSPI_SS, sdSpi);
+  sdMutex = xSemaphoreCreateRecursiveMutex();
+  if (sdOk) logIndexCheck();
+  bbSetup();
 #endif
 
   showSplashThenStartSerial();
 
   lv_init();
 
-  const uint32_t buf_pixels = SCREEN_W * 40; // 40 lines
-  buf1 = (lv_color_t*)heap_caps_malloc(buf_pixels * sizeof(lv_color_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-  buf2 = (lv_color_t*)heap_caps_malloc(buf_pixels * sizeof(lv_color_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-  if (!buf1 || !buf2) {
-    if (buf1) free(buf1);
-    if (buf2) free(buf2);
+  // Draw buffers must be internal, DMA-capable RAM (PSRAM can't feed SPI DMA).
+  // Fall back to 20 lines if the heap is tight, and to the blocking flush if DMA is unavailable.
+  uint32_t buf_pixels = SCREEN_W * 40; // 40 lines
+  for (int attempt = 0; attempt < 2; attempt++) {
+    buf1 = (lv_color_t*)heap_caps_malloc(buf_pixels * sizeof(lv_color_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    buf2 = (lv_color_t*)heap_caps_malloc(buf_pixels * sizeof(lv_color_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (buf1 && buf2) break;
+    if (buf1) heap_caps_free(buf1);
+    if (buf2) heap_caps_free(buf2);
+    buf1 = buf2 = nullptr;
+    buf_pixels = SCREEN_W * 20;
+  }
+  if (buf1 && buf2) {
+    tft.setSwapBytes(!LV_COLOR_16_SWAP);   // LV_COLOR_16_SWAP 1 in lv_conf.h spares this in-place swap
+    tftDmaOk = tft.initDMA();
+  } else {
     buf1 = (lv_color_t*)malloc(buf_pixels * sizeof(lv_color_t));
     buf2 = (lv_color_t*)malloc(buf_pixels * sizeof(lv_color_t));
   }
+  DBG_PRINTF("LVGL: %lu-line buffers, %s flush\n", (unsigned long)(buf_pixels / SCREEN_W), tftDmaOk ? "DMA" : "blocking");
 
   lv_disp_draw_buf_init(&draw_buf, buf1, buf2, buf_pixels);
 
@@ -2209,7 +5891,8 @@ void dashSetup() {
   lv_indev_drv_init(&indev_drv);
   indev_drv.type = LV_INDEV_TYPE_POINTER;
   indev_drv.read_cb = my_touch_read;
-  lv_indev_drv_register(&indev_drv);
+  touchIndev = lv_indev_drv_register(&indev_drv);
+  touchSetup();
 #endif
 
   build_dash();
@@ -2222,53 +5905,71 @@ void dashSetup() {
 
   // IMPORTANT: mark LVGL/UI ready only after everything is built and screen is loaded
   lvReady = true;
+
+  // ECU acquisition, SD logging and NVS writes leave the render core from here on.
+  xTaskCreatePinnedToCore(acqTask, "acq", ACQ_TASK_STACK, nullptr, ACQ_TASK_PRIO, &acqTaskHandle, ACQ_TASK_CORE);
+#if USE_CAN
+  xTaskCreatePinnedToCore(canTask, "can", CAN_TASK_STACK, nullptr, CAN_TASK_PRIO, &canTaskHandle, CAN_TASK_CORE);
+#endif
+#if USE_SD
+  xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, nullptr, LOG_TASK_PRIO, &logTaskHandle, LOG_TASK_CORE);
+#endif
+  xTaskCreatePinnedToCore(prefsTask, "prefs", PREFS_TASK_STACK, nullptr, PREFS_TASK_PRIO, &prefsTaskHandle, PREFS_TASK_CORE);
 }
 
+// Render loop: runs in the Arduino loopTask on core 1. ECU polling/decoding happens in acqTask,
+// the web portal in the async_tcp task.
 void dashLoop() {
-  // If a WiFi station is connected we are in portalMode.
-  // For maximum web stability we pause ALL ECU serial reads/polling and LVGL.
-  if (portalMode) { delay(2); return; }
-
-  while (ECU_SERIAL.available()) onRxByte((uint8_t)ECU_SERIAL.read());
-
-  if (!portalMode && (millis() - lastPoll >= POLL_MS)) {
-    pollSpeeduino();
-    lastPoll = millis();
+  uint32_t lvglIdleMs = 0;   // until LVGL's next timer is due
+  // Work posted by the web handlers (NVS + LVGL are only touched from here).
+  const uint32_t req = uiRequests.exchange(0);
+  if (req & UI_REQ_APPLY) {
+    apply_view_layout();
+    apply_stats_overlay();
+    refresh_settings_list();
+    flashSaved();
   }
-
-  // If a WiFi station is connected, we are in portalMode:
-// - LVGL/UI is stopped completely
-// - TFT shows a static "WEB CONFIGURATION MODE" screen
-if (portalMode) {
-  // Portal mode: prioritize web server + WiFi stack. Avoid extra work.
-  delay(2);
+  if (req & UI_REQ_REC_BTN) setRecButtonActive(recording);
 #if USE_SD
-  // Still allow logging if user left it on (but we stop recording on entry to portal mode for stability)
+  if (req & UI_REQ_SUMMARY) showSessionSummary();
+#endif
+#if USE_BENCH
+  if (req & UI_REQ_BENCH) benchRun();
 #endif
-  return;
-}
-
-// Normal mode: LVGL + dashboard updates
-lvglTick();
-lv_timer_handler();
 
-// dashboard value updates
-static uint32_t lastUi = 0;
-if (!uiPaused && (millis() - lastUi > UI_UPDATE_MS)) {
-  if (lv_scr_act() == scr_dash || lv_scr_act() == scr_shift) update_dash_values();
-  lastUi = millis();
-}
+  lvglTick();
+  {
+    PHASE_SCOPE(PH_LVGL);
+    const uint32_t t0 = micros();
+    lvglIdleMs = lv_timer_handler();
+    lvglPassUs = micros() - t0;
+  }
+  if (lv_scr_act() == scr_dash && curPage == 0) gauge_animate();
 
-#if USE_SD
-logIfRecording();
+  // dashboard value updates
+  static uint32_t lastUi = 0;
+#if USE_GOVERNOR
+  gov_update();
+  if (millis() - lastUi > govUiMs) {
+#else
+  if (millis() - lastUi > UI_UPDATE_MS) {
 #endif
+    if (lv_scr_act() == scr_dash || lv_scr_act() == scr_shift) {
+      PHASE_SCOPE(PH_UI);
+      update_dash_values();
+    }
+    lastUi = millis();
+  }
 
-if (lbl_saved && savedUntilMs != 0) {
-  if (millis() > savedUntilMs) {
-    lv_obj_add_flag(lbl_saved, LV_OBJ_FLAG_HIDDEN);
-    savedUntilMs = 0;
+  if (lbl_saved && savedUntilMs != 0) {
+    if (millis() > savedUntilMs) {
+      lv_obj_add_flag(lbl_saved, LV_OBJ_FLAG_HIDDEN);
+      savedUntilMs = 0;
+    }
   }
+#if USE_GOVERNOR
+  gov_sleep(lvglIdleMs);
+#else
+  (void)lvglIdleMs;
+#endif
 }
-}
-
-
@@ -55,6 +55,9 @@
 #define LV_USE_LABEL 1
 #define LV_USE_LINE 1
 
+/* Ring view caches its static meter face as an image */
+#define LV_USE_SNAPSHOT 1
+
 /*====================
  * Extra widgets (TURN OFF!)
  *====================*/